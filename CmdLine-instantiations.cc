@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// File: CmdLine-instantiations.cc                                           //
+// Part of the CmdLine library                                               //
+//                                                                           //
+// Copyright (c) 2007-2023 Gavin Salam with contributions from               //
+// Gregory Soyez and Rob Verheyen                                            //
+//                                                                           //
+// This program is free software; you can redistribute it and/or modify      //
+// it under the terms of the GNU General Public License as published by      //
+// the Free Software Foundation; either version 2 of the License, or         //
+// (at your option) any later version.                                       //
+//                                                                           //
+// This program is distributed in the hope that it will be useful,           //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of            //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             //
+// GNU General Public License for more details.                              //
+//                                                                           //
+// You should have received a copy of the GNU General Public License         //
+// along with this program; if not, write to the Free Software               //
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// Explicit instantiations of the option-value templates for one type,
+// CMDLINE_INSTANTIATION_TYPE, which is set when compiling (see the
+// Makefile), for options with a single value or, if
+// CMDLINE_INSTANTIATE_MULTIPLE is defined, for options with several
+// values. Each goes in its own object file, so that a program linking
+// with libCmdLine.a only pulls in what it uses.
+
+#include "CmdLine.hh"
+
+#ifndef CMDLINE_INSTANTIATION_TYPE
+#error "CMDLINE_INSTANTIATION_TYPE should be defined when compiling CmdLine-instantiations.cc"
+#endif
+
+#ifdef CMDLINE_INSTANTIATE_MULTIPLE
+CMDLINE_INSTANTIATIONS_MULTIPLE(, CMDLINE_INSTANTIATION_TYPE)
+#else
+CMDLINE_INSTANTIATIONS_SINGLE(, CMDLINE_INSTANTIATION_TYPE)
+#endif
@@ -0,0 +1,610 @@
+///////////////////////////////////////////////////////////////////////////////
+// File: CmdLine-templates.hh                                                //
+// Part of the CmdLine library
+//                                                                           //
+// Copyright (c) 2007-2023 Gavin Salam with contributions from               //
+// Gregory Soyez and Rob Verheyen                                            //
+//                                                                           //
+// This program is free software; you can redistribute it and/or modify      //
+// it under the terms of the GNU General Public License as published by      //
+// the Free Software Foundation; either version 2 of the License, or         //
+// (at your option) any later version.                                       //
+//                                                                           //
+// This program is distributed in the hope that it will be useful,           //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of            //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             //
+// GNU General Public License for more details.                              //
+//                                                                           //
+// You should have received a copy of the GNU General Public License         //
+// along with this program; if not, write to the Free Software               //
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// Definitions of the CmdLine templates. This file is included by
+// CmdLine.hh, unless __CMDLINE_LIGHT_HEADER__ is defined, in which case
+// only the types that are explicitly instantiated in libCmdLine.a (see
+// CMDLINE_INSTANTIATIONS in CmdLine.hh) can be used for option values.
+
+#ifndef __CMDLINE_TEMPLATES__
+#define __CMDLINE_TEMPLATES__
+
+#include "CmdLine.hh"
+#include<sstream>
+#include<iostream>
+#include<mutex>
+#include<type_traits>
+#include<cctype>
+#include<cstdio>
+#include<unordered_set>
+
+//----------------------------------------------------------------------
+/// read-only memory mapping of a whole file; if the file cannot be
+/// mapped (e.g. it is a pipe), its content is read into memory instead
+class CmdLine::MappedFile {
+public:
+  MappedFile(const std::string & filename);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+
+  const char * data() const {return _data;}
+  size_t size() const {return _size;}
+  const std::string & filename() const {return _filename;}
+  /// 64-bit FNV-1a hash of the content, computed on the first call
+  uint64_t hash() const;
+
+private:
+  std::string _filename;
+  void * _mapped = nullptr;
+  const char * _data = nullptr;
+  size_t _size = 0;
+  std::string _buffer;
+  mutable std::once_flag _hash_flag;
+  mutable uint64_t _hash = 0;
+};
+
+template<class T> CmdLine::MappedArray<T>::MappedArray(const std::string & value) : _reference(value) {
+  if (value.size() > 1 && value[0] == '@') {
+    std::string filename = value.substr(1);
+    bool binary = __is_binary_filename(filename);
+    if (binary && !std::is_trivially_copyable<T>::value) {
+      throw Error("cannot map binary file " + filename + " onto an array of non-trivially-copyable type " 
+                  + OptionHelp::demangle(typeid(T).name()));
+    }
+    std::string key = std::string(binary ? "binary:" : "text:") + typeid(T).name() 
+                      + ":" + __canonical_path(filename);
+    _payload = std::static_pointer_cast<const Payload>(__shared_object(key, [&]() {
+      auto payload = std::make_shared<Payload>();
+      std::shared_ptr<const MappedFile> file = __mapped_file(filename);
+      payload->from_file = true;
+      if (binary) {
+        if (file->size() % sizeof(T) != 0) {
+          throw Error("size of file " + filename + " (" + std::to_string(file->size()) 
+                      + " bytes) is not a multiple of the size of " + OptionHelp::demangle(typeid(T).name()));
+        }
+        payload->file = file;
+      } else {
+        _parse_text(*file, *payload);
+        payload->hash = file->hash();
+      }
+      return std::shared_ptr<const void>(payload);
+    }));
+  } else {
+    auto payload = std::make_shared<Payload>();
+    payload->values.push_back(CmdLine_string_to_value<T>(value));
+    payload->hash = __fnv1a_64(value.data(), value.size());
+    _payload = payload;
+  }
+  if (_payload->file) {
+    _data = reinterpret_cast<const T *>(_payload->file->data());
+    _size = _payload->file->size() / sizeof(T);
+  } else {
+    _data = _payload->values.data();
+    _size = _payload->values.size();
+  }
+}
+
+template<class T> void CmdLine::MappedArray<T>::_parse_text(const MappedFile & file, Payload & payload) {
+  const char * pos = file.data(), * end = file.data() + file.size();
+  std::string token;
+  while (pos != end) {
+    if (std::isspace(static_cast<unsigned char>(*pos))) {++pos; continue;}
+    if (*pos == '#') {
+      while (pos != end && *pos != '\n') ++pos;
+      continue;
+    }
+    const char * token_end = pos;
+    while (token_end != end && !std::isspace(static_cast<unsigned char>(*token_end))) ++token_end;
+    token.assign(pos, token_end);
+    try {
+      payload.values.push_back(CmdLine_string_to_value<T>(token));
+    } catch (const ConversionFailure &) {
+      throw Error("could not convert \"" + token + "\" in file " + file.filename() 
+                  + " to a value of type " + OptionHelp::demangle(typeid(T).name()));
+    }
+    pos = token_end;
+  }
+}
+
+template<class T> uint64_t CmdLine::MappedArray<T>::hash() const {
+  if (binary()) return _payload->file->hash();
+  if (_payload) return _payload->hash;
+  return __fnv1a_64(_reference.data(), _reference.size());
+}
+
+/// returns the value from which the array was constructed (e.g. @table.bin)
+template<class T> std::string CmdLine_value_to_string(const CmdLine::MappedArray<T> & array) {
+  return array.reference();
+}
+/// for arrays read from a file, returns the number of elements and the content hash
+template<class T> std::string CmdLine_value_annotation(const CmdLine::MappedArray<T> & array) {
+  if (!array.from_file()) return "";
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(array.hash()));
+  return std::to_string(array.size()) + " elements (" + std::to_string(array.size() * sizeof(T)) 
+         + " bytes), fnv1a64 " + hash;
+}
+
+template<class T> 
+void CmdLine::Result<T>::throw_value_not_available() const {
+  std::ostringstream ostr;
+  ostr << "value of option ";
+  if (_opthelp) ostr << _opthelp->option;
+  else ostr << "[unknown -- because help disabled]";
+  ostr << " requested, but that value is not available\n"
+       << "because the option was not present on the command line and no default was supplied\n";
+  throw Error(ostr.str());
+}
+
+/// returns the value of the argument, convertible to type T
+template<class T> CmdLine::Result<T> CmdLine::any_value(const OptionNames & opts) const {
+  // we create the result from the (more general) value_prefix
+  // function, with an empty prefix
+  return any_value_prefix<T>(opts,"");
+}
+
+/// makes result the latest result of its option, reusing the storage of
+/// the previous result when nothing else refers to it, and returns it
+template<class T> CmdLine::Result<T> CmdLine::__record_result(OptionHelp * opthelp, Result<T> && result) const {
+  if (!opthelp) return std::move(result);
+  std::shared_ptr<ResultBase> & stored = opthelp->result_ptr;
+  Result<T> * previous = stored.use_count() == 1 ? dynamic_cast<Result<T> *>(stored.get()) : nullptr;
+  if (previous) *previous = std::move(result);
+  else          stored = std::make_shared<Result<T>>(std::move(result));
+  return *static_cast<Result<T> *>(stored.get());
+}
+
+/// returns the value of the argument converted to type T
+template<class T> 
+CmdLine::Result<T> CmdLine::any_value_prefix(const OptionNames & opts, 
+                                             const std::string & prefix) const {
+  OptionHelp * opthelp = opthelp_ptr(opts, OptKind::required_value, "", 
+                                     [&]{return OptionHelp_value_required<T>(opts, "");});
+
+  T result;
+  bool present = true;
+  if (__help_requested && internal_present(opts).second < 0) {
+    result = value_for_missing_option<T>();
+    present = false;
+  } else {
+    result = internal_value<T>(opts, prefix);
+  }
+  return __record_result(opthelp, Result<T>(std::move(result), opthelp, present, OptKind::required_value));
+}
+
+
+template<class T> CmdLine::Result<T> CmdLine::any_value(const OptionNames & opts, const T & defval) const {
+  return any_value<T>(opts, defval, "");
+}
+
+template<class T, class F> 
+CmdLine::Result<T> CmdLine::any_value_or_else(const OptionNames & opts, const F & default_fn,
+                                              const std::string & default_help) const {
+  // the default is computed only if the option is absent or if the help
+  // is requested and must show it, i.e. when there is no default_help
+  auto pres = this->internal_present(opts);
+  const bool compute_default = default_help.empty() ? (pres.first <= 0 || __help_requested) 
+                                                    : (pres.first <= 0 && !__help_requested);
+  std::unique_ptr<T> defval;
+  if (compute_default) defval.reset(new T(default_fn()));
+  std::string default_string = default_help;
+  if (default_string.empty()) default_string = defval ? CmdLine_value_to_string(*defval) : "(computed)";
+  OptionHelp * opthelp = opthelp_ptr(opts, OptKind::value_with_default, default_string,
+                                     [&]{return OptionHelp_value_or_else<T>(opts, default_string);});
+
+  // return value
+  if (pres.second > 0) {
+    return __record_result(opthelp, Result<T>(internal_value<T>(opts), opthelp, true, OptKind::value_with_default));
+  } else if (pres.first > 0) {
+    throw Error("option " + __argument(pres.first) + " present, but expected value was absent");
+  } else if (defval) {
+    return __record_result(opthelp, Result<T>(std::move(*defval), opthelp, false, OptKind::value_with_default));
+  } else {
+    // help was requested and the default was not computed
+    return __record_result(opthelp, Result<T>(value_for_missing_option<T>(), opthelp, false, 
+                                              OptKind::value_with_default, true));
+  }
+}
+
+template<class T> CmdLine::Result<T> CmdLine::any_optional_value(const OptionNames & opts) const {
+  // construct help
+  OptionHelp * opthelp = opthelp_ptr(opts, OptKind::optional_value, "", 
+                                     [&]{return OptionHelp_optional_value<T>(opts);});
+  if (opthelp) opthelp->default_value = "None";
+
+  // return value
+  auto pres = this->internal_present(opts);
+  if (pres.second > 0) {
+    return __record_result(opthelp, Result<T>(internal_value<T>(opts), opthelp, true, OptKind::optional_value));
+  } else if (pres.first > 0) {
+    throw Error("option " + __argument(pres.first) + " present, but expected value was absent");
+  } else {    
+    return __record_result(opthelp, Result<T>(value_for_missing_option<T>(), opthelp, false, OptKind::optional_value));
+  }
+}
+
+
+template<class T> CmdLine::Result<T> CmdLine::any_value(const OptionNames & opts, const T & defval, 
+                                                        const std::string & prefix) const {
+  // the default value in string form is needed to check it against
+  // any earlier query of the same option
+  const std::string default_string = CmdLine_value_to_string(defval);
+  OptionHelp * opthelp = opthelp_ptr(opts, OptKind::value_with_default, default_string,
+                                     [&]{return OptionHelp_value_with_default(opts, defval, "");});
+
+  // return value
+  auto pres = this->internal_present(opts);
+  if (pres.second > 0) {
+    return __record_result(opthelp, Result<T>(internal_value<T>(opts, prefix), opthelp, true, OptKind::value_with_default));
+  } else if (pres.first > 0) {
+    throw Error("option " + __argument(pres.first) + " present, but expected value was absent");
+  } else {
+    return __record_result(opthelp, Result<T>(defval, opthelp, false, OptKind::value_with_default));
+  }
+}
+
+template<class T>
+CmdLine::Result<T> CmdLine::reuse_value(OptionName opt) const {
+  const OptionHelp * opthelp = existing_opthelp_ptr(opt);
+  if (!opthelp) {
+    throw Error("`reuse_value<T>(\"" + opt.str() + "\")` requires " + opt.str() + " to have been"
+                " previously queried with `value<T>(\""+opt.str()+
+                "\" [, ...])`, but no prior query for that option was found");
+  }
+  if (!opthelp->takes_value) {
+    throw Error("option " + opt.str() + " was previously queried, but did not take a value (e.g. used with present())");
+  }
+
+  const char * requested_type = typeid(T).name();
+  if (opthelp->type != requested_type) {
+    throw Error("option " + opt.str() + " was previously queried with type '"
+                + OptionHelp::demangle(opthelp->type)
+                + "' but reuse_value requested type '"
+                + OptionHelp::demangle(requested_type) + "'");
+  }
+
+  auto reused_result = std::dynamic_pointer_cast<Result<T>>(opthelp->result_ptr);
+  if (!reused_result) {
+    throw Error("could not reuse stored value for option " + opt.str());
+  }
+  return *reused_result;
+}
+
+template<class T>
+std::ostream & operator<<(std::ostream & ostr, const CmdLine::Result<T> & result) {
+  ostr << result();
+  return ostr;
+}
+
+template<class T>
+std::string CmdLine::Result<T>::value_as_string() const {
+  return CmdLine_value_to_string(value());
+}
+
+/// set of the allowed choices of an option: a hash set for types with a
+/// standard hash (arithmetic types, enums and strings), otherwise a list
+template<class T, class Enable = void> class CmdLine_choice_set {
+public:
+  void assign(const std::vector<T> & values) {_values = values;}
+  bool contains(const T & value) const {
+    for (const auto & v: _values) {if (value == v) return true;}
+    return false;
+  }
+private:
+  std::vector<T> _values;
+};
+template<class T> class CmdLine_choice_set<T, typename std::enable_if<
+                  std::is_arithmetic<T>::value || std::is_enum<T>::value
+                  || std::is_same<T,std::string>::value>::type> {
+public:
+  void assign(const std::vector<T> & values) {_values = std::unordered_set<T>(values.begin(), values.end());}
+  bool contains(const T & value) const {return _values.count(value) != 0;}
+private:
+  std::unordered_set<T> _values;
+};
+
+/// the choices and range of an option of type T
+template<class T> class CmdLine::Validator : public CmdLine::ValidatorBase {
+public:
+  /// the choices as first given (empty if none), to check that later
+  /// calls give the same ones, and the corresponding set for lookups
+  std::vector<T> choices;
+  CmdLine_choice_set<T> choice_set;
+  /// empty, or the minimum and maximum values
+  std::vector<T> range;
+};
+
+template<class T>
+CmdLine::Validator<T> & CmdLine::Result<T>::_validator(Validator<T> & local) const {
+  if (!_opthelp) return local;
+  auto validator = std::dynamic_pointer_cast<Validator<T>>(_opthelp->validator);
+  if (!validator) {
+    validator = std::make_shared<Validator<T>>();
+    _opthelp->validator = validator;
+  }
+  return *validator;
+}
+
+template<class T>
+std::string CmdLine::Result<T>::_option_name() const {
+  return _opthelp ? _opthelp->option : "[unknown -- because help disabled]";
+}
+
+template<class T>
+const CmdLine::Result<T> & CmdLine::Result<T>::choices(
+                             const std::vector<T> & allowed_choices,
+                             const std::vector<std::string> & choices_help
+                             ) const {
+
+  Validator<T> local;
+  Validator<T> & validator = _validator(local);
+  if (validator.choices.size() == 0) {
+    // first call: build the set, and register the choices with the help
+    // module, replacing any that were set automatically from the names
+    // of the type's values
+    validator.choices = allowed_choices;
+    validator.choice_set.assign(allowed_choices);
+    if (_opthelp) {
+      if (_opthelp->automatic_choices) {
+        _opthelp->choices.clear();
+        _opthelp->automatic_choices = false;
+      }
+      std::vector<std::string> choice_strings;
+      choice_strings.reserve(allowed_choices.size());
+      for (const auto & choice: allowed_choices) {
+        choice_strings.push_back(CmdLine_value_to_string(choice));
+      }
+      if (_opthelp->choices.size() != 0 && _opthelp->choices != choice_strings) {
+        throw Error("For "+ _opthelp->option+ " option, choices must be the same as those already set: "
+                    + _opthelp->choice_list());
+      }
+      _opthelp->choices = std::move(choice_strings);
+    }
+  } else {
+    // later calls must give the same choices, which are then not reprocessed
+    if (validator.choices.size() != allowed_choices.size()) {
+      throw Error("For "+ _option_name() + " option, overwriting choices vector must be same size as existing allowed_choices");
+    }
+    for (unsigned i = 0; i < allowed_choices.size(); ++i) {
+      if (!(validator.choices[i] == allowed_choices[i])) {
+        throw Error("For "+ _option_name() + " option, overwrite choice at index " + std::to_string(i) + " = "
+                    + CmdLine_value_to_string(allowed_choices[i]) + " must be same as choice already set at that index, "
+                    + CmdLine_value_to_string(validator.choices[i]));
+      }
+    }
+  }
+  if (choices_help.size() != 0) {
+    if (choices_help.size() != allowed_choices.size()) {
+      throw Error("choices_help vector must be same size as allowed_choices vector");
+    }
+    if (_opthelp && _opthelp->choices_help != choices_help) _opthelp->choices_help = choices_help;
+  }
+
+  // check the choice actually made is valid
+  if (!_placeholder() && !validator.choice_set.contains(_t.get())) {
+    std::ostringstream ostr;
+    ostr << "For option " << _option_name() << ", invalid option value " 
+         << CmdLine_value_to_string(_t.get()) << ". Allowed choices are: ";
+    if (_opthelp) {
+      ostr << _opthelp->choice_list();
+    } else {
+      for (unsigned i = 0; i < allowed_choices.size(); ++i) {
+        ostr << (i == 0 ? "" : ", ") << CmdLine_value_to_string(allowed_choices[i]);
+      }
+    }
+    throw Error(ostr.str());
+  }
+  return *this;
+}
+
+template<class T>
+const CmdLine::Result<T> & CmdLine::Result<T>::range(T minval, T maxval) const {
+  Validator<T> local;
+  Validator<T> & validator = _validator(local);
+  if (validator.range.size() == 0) {
+    validator.range = {minval, maxval};
+    if (_opthelp) {
+      _opthelp->range_strings = {CmdLine_value_to_string(minval), CmdLine_value_to_string(maxval)};
+    }
+  } else if (!(validator.range[0] == minval) || !(validator.range[1] == maxval)) {
+    throw Error("For " + _option_name() + " option, range " + CmdLine_value_to_string(minval) + " to "
+                + CmdLine_value_to_string(maxval) + " must be same as range already set, "
+                + CmdLine_value_to_string(validator.range[0]) + " to " + CmdLine_value_to_string(validator.range[1]));
+  }
+  if (!_placeholder() && (_t.get() < minval || _t.get() > maxval)) {
+    std::ostringstream errstr;
+    errstr << "For option " << _option_name() << ", option value " << CmdLine_value_to_string(_t.get()) 
+           << " out of allowed range: " 
+           << CmdLine_value_to_string(minval) << " <= " << (_opthelp ? _opthelp->argname : "val")
+           << " <= " << CmdLine_value_to_string(maxval);
+    throw Error(errstr.str());
+  }
+  return *this;
+}
+
+/// default conversion to string, using an istringstream; the struct
+/// can be (partially) specialised for families of types, which is not
+/// possible for the CmdLine_string_to_value function template
+template<class T, class Enable> struct CmdLine_string_converter {
+  static T convert(const std::string & str) {
+    std::istringstream optstream(str);
+    T result;
+    optstream >> result;
+    if (optstream.fail()) {throw CmdLine::ConversionFailure(str);}
+    return result;
+  }
+};
+
+/// default conversion to string, using CmdLine_string_converter<T>
+/// NB: this is outside the class, because some compilers
+/// can't handle-in class specialisations
+template<class T> T CmdLine_string_to_value(const std::string & str) {
+  return CmdLine_string_converter<T>::convert(str);
+}
+
+/// default non-throwing conversion, which calls CmdLine_string_to_value
+/// (so that user specialisations are respected) and catches its
+/// ConversionFailure; the common types have specialisations that avoid
+/// the exception altogether
+template<class T> bool CmdLine_try_string_to_value(const std::string & str, T & value) {
+  try {
+    value = CmdLine_string_to_value<T>(str);
+    return true;
+  } catch (const CmdLine::ConversionFailure &) {
+    return false;
+  }
+}
+
+/// default conversion of a value to a string, using an ostringstream
+/// (with 16 digits precision); like CmdLine_string_to_value, it can be
+/// specialised by the user for further types
+template<class T> std::string CmdLine_value_to_string(const T & value) {
+  std::ostringstream ostr;
+  ostr.precision(16);
+  ostr << value;
+  return ostr.str();
+}
+
+/// conversion of a vector of values to a string, with values separated by spaces
+template<class T> std::string CmdLine_value_to_string(const std::vector<T> & values) {
+  std::string result;
+  for (const auto & value: values) {
+    if (result.size() != 0) result += " ";
+    result += CmdLine_value_to_string(value);
+  }
+  return result;
+}
+
+/// conversion of a value to a vector containing a single string
+template<class T> std::vector<std::string> CmdLine_values_to_strings(const T & value) {
+  return {CmdLine_value_to_string(value)};
+}
+/// conversion of a vector of values to a vector of strings, one per value
+template<class T> std::vector<std::string> CmdLine_values_to_strings(const std::vector<T> & values) {
+  std::vector<std::string> result;
+  result.reserve(values.size());
+  for (const auto & value: values) result.push_back(CmdLine_value_to_string(value));
+  return result;
+}
+
+/// default annotation of a value, which is empty
+template<class T> std::string CmdLine_value_annotation(const T &) {return "";}
+
+template<class T> T CmdLine::internal_value(const OptionNames & opts, const std::string & prefix) const {
+  const std::string & value_string = internal_string_val(opts);
+  try {
+    if (!prefix.empty()) return CmdLine_string_to_value<T>(prefix + value_string);
+    // the non-throwing conversion avoids the istringstream for the common
+    // types; on failure, the throwing one is called for its message
+    T result;
+    if (CmdLine_try_string_to_value<T>(value_string, result)) return result;
+    return CmdLine_string_to_value<T>(value_string);
+  } catch (const ConversionFailure & failure) {
+    std::string opt = __argument(internal_present(opts).first);
+    _report_conversion_failure(opt, failure.what(), typeid(T).name());
+  }
+}
+
+template<class T> CmdLine::Expected<T> CmdLine::try_value(OptionName opt) const {
+  OptionHelp * opthelp = opthelp_ptr(opt, OptKind::required_value, "", 
+                                     [&]{return OptionHelp_value_required<T>(opt, "");});
+  return __try_value<T>(opt, opthelp, nullptr);
+}
+
+template<class T> CmdLine::Expected<T> CmdLine::try_value(OptionName opt, const T & defval) const {
+  const std::string default_string = CmdLine_value_to_string(defval);
+  OptionHelp * opthelp = opthelp_ptr(opt, OptKind::value_with_default, default_string, 
+                                     [&]{return OptionHelp_value_with_default(opt, defval, "");});
+  return __try_value<T>(opt, opthelp, &defval);
+}
+
+template<class T> 
+CmdLine::Expected<T> CmdLine::__try_value(OptionName opt, OptionHelp * opthelp, 
+                                          const T * defval) const {
+  const OptKind kind = defval ? OptKind::value_with_default : OptKind::required_value;
+  std::pair<int,int> pres = internal_present(opt);
+  if (pres.second > 0) {
+    const std::string & optstring = __argument(pres.second);
+    __arguments_used[pres.second] = true;
+    // as in internal_string_val, a value that looks like an option is declared used
+    if (optstring.compare(0,1,"-") == 0) {__set_option_used(optstring);}
+    T result;
+    if (!CmdLine_try_string_to_value<T>(optstring, result)) {
+      return ParseError(ParseError::conversion_failure, opt.str(), pres.second, optstring, typeid(T).name());
+    }
+    return __record_result(opthelp, Result<T>(std::move(result), opthelp, true, kind)).value();
+  } else if (pres.first > 0 && (defval || !__help_requested)) {
+    return ParseError(ParseError::value_absent, opt.str(), pres.first);
+  } else if (defval) {
+    return __record_result(opthelp, Result<T>(*defval, opthelp, false, kind)).value();
+  } else if (__help_requested) {
+    return __record_result(opthelp, Result<T>(value_for_missing_option<T>(), opthelp, false, kind)).value();
+  } else {
+    return ParseError(ParseError::option_absent, opt.str(), -1);
+  }
+}
+
+template<class T> 
+CmdLine::Result<std::vector<T>> CmdLine::any_value_all(const OptionNames & opts) const {
+  OptionHelp * opthelp = opthelp_ptr(opts, OptKind::all_values, "", 
+                                     [&]{return OptionHelp_all_values<T>(opts);});
+
+  std::vector<std::pair<int,int>> locations = internal_present_all(opts);
+  std::vector<T> values;
+  values.reserve(locations.size());
+  for (const auto & location: locations) {
+    if (location.second < 0) {
+      if (__help_requested) continue;
+      throw Error("option " + __argument(location.first) + " present, but expected value was absent");
+    }
+    __arguments_used[location.second] = true;
+    const std::string & optstring = __argument(location.second);
+    try {
+      values.push_back(CmdLine_string_to_value<T>(optstring));
+    } catch (const ConversionFailure & failure) {
+      _report_conversion_failure(__argument(location.first), failure.what(), typeid(T).name());
+    }
+  }
+  return __record_result(opthelp, Result<std::vector<T>>(std::move(values), opthelp, locations.size() != 0, OptKind::all_values));
+}
+
+template<class T> 
+CmdLine::Result<std::vector<T>> CmdLine::positional(const std::string & name, unsigned min_count, 
+                                                    unsigned max_count) const {
+  OptionHelp * opthelp = opthelp_ptr(OptionHelp_positional<T>(name, min_count, max_count));
+  ArgView view = __positional_view(name, min_count, max_count);
+  std::vector<T> values;
+  values.reserve(view.size());
+  for (size_t i = 0; i < view.size(); i++) {
+    try {
+      values.push_back(CmdLine_string_to_value<T>(view[i]));
+    } catch (const ConversionFailure & failure) {
+      _report_conversion_failure(name + " (at position " + std::to_string(view.position(i)) + ")", 
+                                 failure.what(), typeid(T).name());
+    }
+  }
+  return __record_result(opthelp, Result<std::vector<T>>(std::move(values), opthelp, view.size() != 0, OptKind::positional));
+}
+
+#endif // __CMDLINE_TEMPLATES__
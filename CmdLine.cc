@@ -35,22 +35,56 @@
 #include <sys/utsname.h> // for getting uname
 #include <unistd.h> // for getting current path
 #include <stdlib.h> // for getting the environment (including username)
+#include <fcntl.h> // for opening files to be mapped
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for file sizes
+#include <sys/resource.h> // for getrusage
+#include <cstring> // for memchr
+#include <cerrno>
+#include <iterator>
+#include <mutex> // for std::call_once
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <limits>
 #ifdef __CMDLINE_ABI_DEMANGLE__
 #include <cxxabi.h>
 #endif 
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
 
 using namespace std;
 
 string CmdLine::_default_argfile_option = "-argfile";
+#if __cplusplus < 201703L
+constexpr unsigned CmdLine::any_count;
+#endif
+string CmdLine::_sweep_index_option = "--sweep-index";
+string CmdLine::_sweep_size_option  = "--sweep-size";
+string CmdLine::_sweep_zip_option   = "--sweep-zip";
+
+namespace {
+  /// while non-zero, CmdLine::Error does not print its message (used
+  /// where errors are caught internally and reported as a ParseError)
+  thread_local int quiet_errors = 0;
+  struct QuietErrors {
+    QuietErrors(bool quiet) : _quiet(quiet) {if (_quiet) quiet_errors++;}
+    ~QuietErrors() {if (_quiet) quiet_errors--;}
+    bool _quiet;
+  };
+}
 
 std::ostream & operator<<(std::ostream & ostr, CmdLine::OptKind optkind) {
   if      (optkind == CmdLine::OptKind::present) ostr << "present";
   else if (optkind == CmdLine::OptKind::required_value) ostr << "required_value";
   else if (optkind == CmdLine::OptKind::optional_value) ostr << "optional_value";
   else if (optkind == CmdLine::OptKind::value_with_default) ostr << "value_with_default";
+  else if (optkind == CmdLine::OptKind::all_values) ostr << "all_values";
+  else if (optkind == CmdLine::OptKind::positional) ostr << "positional";
   else if (optkind == CmdLine::OptKind::undefined) ostr << "undefined";
   else ostr << "UNRECOGNISED";
   return ostr;
@@ -65,9 +99,10 @@ std::ostream & operator<<(std::ostream & ostr, CmdLine::OptKind optkind) {
 CmdLine::CmdLine (const int argc, char** argv, bool enable_help, const string & file_option) : 
     __help_enabled(enable_help), __argfile_option(file_option) {
 
-  __arguments.resize(argc);
+  __parsed = std::make_shared<Parsed>();
+  __parsed->arguments.resize(argc);
   for(int iarg = 0; iarg < argc; iarg++){
-    __arguments[iarg] = argv[iarg];
+    __parsed->arguments[iarg] = argv[iarg];
   }
   this->init();
 }
@@ -80,10 +115,41 @@ CmdLine::CmdLine (const vector<string> & args, bool enable_help, const string &
   if (args[0].size() == 0) throw Error("CmdLine constructor: args[0] is empy, but should contain a command name");
   if (args[0][0] == '-') throw Error("CmdLine constructor: args[0] = '" + args[0] + "' starts with a -, but should contain a command name");
 
-  __arguments = args;
+  __parsed = std::make_shared<Parsed>();
+  __parsed->arguments = args;
   this->init();
 }
 
+//----------------------------------------------------------------------
+CmdLine::Expected<CmdLine> CmdLine::try_parse(const vector<string> & args, bool enable_help, 
+                                              const string & file_option) {
+  if (args.size() == 0 || args[0].size() == 0 || args[0][0] == '-') {
+    return ParseError(ParseError::bad_command_name, "", 0, args.size() == 0 ? "" : args[0]);
+  }
+  CmdLine cmdline;
+  cmdline.__help_enabled = enable_help;
+  cmdline.__argfile_option = file_option;
+  cmdline.__parsed = std::make_shared<Parsed>();
+  cmdline.__parsed->arguments = args;
+  ParseError error;
+  if (!cmdline.init(&error)) return error;
+  return cmdline;
+}
+
+CmdLine::Expected<CmdLine> CmdLine::try_parse(const string & cmdline_string, bool enable_help, 
+                                              const string & file_option) {
+  Tokens tokens;
+  size_t error_position;
+  if (!__tokenize(cmdline_string, tokens, error_position)) {
+    return ParseError(ParseError::bad_quoting, "", int(error_position), cmdline_string);
+  }
+  return try_parse(tokens.strings(), enable_help, file_option);
+}
+
+/// constructor from a string, split with tokenize
+CmdLine::CmdLine (const string & cmdline_string, bool enable_help, const string & file_option) :
+    CmdLine(tokenize(cmdline_string).strings(), enable_help, file_option) {}
+
 /// Add an overall help string
 CmdLine & CmdLine::help(const std::string & help_str) {
   __overall_help_string = help_str;
@@ -92,9 +158,22 @@ CmdLine & CmdLine::help(const std::string & help_str) {
 }
 
 //----------------------------------------------------------------------
-void CmdLine::init (){
+bool CmdLine::init (ParseError * error){
+  if (!__parse_arguments(error)) return false;
+
+  // by default, enabe the git info
+  set_git_info_enabled(true);
+
+  return __register_help_options(error);
+}
+
+//----------------------------------------------------------------------
+bool CmdLine::__parse_arguments(ParseError * error) {
+  vector<string> & arguments = __parsed->arguments;
+  auto & options = __parsed->options;
+
   // record time at start
-  time(&__time_at_start);
+  __record_start_time();
 
   // this does not work...
   //__options_help[__argfile_option] = 
@@ -102,20 +181,25 @@ void CmdLine::init (){
   //                          "if present, further arguments are read from the filename");
 
   // check first if a file option is passed
-  for(size_t iarg = 0; iarg < __arguments.size(); iarg++) {
-    const string & arg = __arguments[iarg];
+  for(size_t iarg = 0; iarg < arguments.size(); iarg++) {
+    const string & arg = arguments[iarg];
     if (arg == __argfile_option) {
       // make sure a file is passed too
       bool found_file = true;
       ifstream file_in;
-      if (iarg+1 == __arguments.size()) found_file = false;
+      if (iarg+1 == arguments.size()) found_file = false;
       else {
-        file_in.open(__arguments[iarg+1].c_str());
+        file_in.open(arguments[iarg+1].c_str());
         found_file = file_in.good();
       }
 
       // error if no file found
       if (!found_file) {
+        if (error) {
+          *error = ParseError(ParseError::argfile_not_found, __argfile_option, int(iarg), 
+                              iarg+1 == arguments.size() ? "" : arguments[iarg+1]);
+          return false;
+        }
         ostringstream ostr;
         ostr << "Option "<< __argfile_option
              <<" is passed but no file was found"<<endl;
@@ -123,7 +207,7 @@ void CmdLine::init (){
       }
 
       // remove the file options from the list of arguments
-      __arguments.erase(__arguments.begin()+iarg, __arguments.begin()+iarg+2);
+      arguments.erase(arguments.begin()+iarg, arguments.begin()+iarg+2);
 
       string read_string = "";
       while (file_in >> read_string) {
@@ -134,7 +218,7 @@ void CmdLine::init (){
           getline(file_in, read_string);
         }
         else {
-          __arguments.push_back(read_string);
+          arguments.push_back(read_string);
         }
       }
 
@@ -143,97 +227,370 @@ void CmdLine::init (){
     }
   }
 
+  // select a single point if the arguments describe a parameter sweep
+  if (!__expand_sweep(error)) return false;
+
   // record whole command line so that it can be easily reused
-  __command_line = "";
-  for(size_t iarg = 0; iarg < __arguments.size(); iarg++){
-    const string & arg = __arguments[iarg];
-    // if an argument contains special characters, enclose it in
-    // single quotes [NB: does not work if it contains a single quote
-    // itself: treated below]
-    if (arg.find(' ') != string::npos ||
-        arg.find('|') != string::npos ||
-        arg.find('<') != string::npos || 
-        arg.find('>') != string::npos || 
-        arg.find('"') != string::npos || 
-        arg.find('#') != string::npos) {
-      __command_line += "'"+arg+"'";
-    } else if (arg.find("'") != string::npos) {
-      // handle the case with single quotes in the argument
-      // (NB: if there are single and double quotes, we are in trouble...)
-      __command_line += '"'+arg+'"';
-    } else {
-      __command_line += arg;
-    }
-    __command_line += " ";
+  __parsed->command_line.clear();
+  for(size_t iarg = 0; iarg < arguments.size(); iarg++){
+    __append_quoted(__parsed->command_line, arguments[iarg]);
+    __parsed->command_line += " ";
   }
   
-  // group things into options
+  // group things into options (the entries in the option maps reuse
+  // the nodes left by a previous parse, cf. reset)
   bool next_may_be_val = false;
-  string currentopt;
-  __arguments_used.resize(__arguments.size(), false);
+  pair<int,int> * currentopt = nullptr;
+  __arguments_used.assign(arguments.size(), false);
   __arguments_used[0] = true;
-  for(size_t iarg = 1; iarg < __arguments.size(); iarg++){
+  __parsed->previous_occurrence.assign(arguments.size(), -1);
+  for(size_t iarg = 1; iarg < arguments.size(); iarg++){
+    // a standalone -- ends the options
+    if (arguments[iarg] == "--") {
+      __parsed->end_of_options = iarg;
+      break;
+    }
     // if expecting an option value, then take it (even if
     // it is actually next option...)
-    if (next_may_be_val) {__options[currentopt].second = iarg;}
+    if (next_may_be_val) {currentopt->second = iarg;}
     // now see if it might be an option itself
-    string arg = __arguments[iarg];
+    const string & arg = arguments[iarg];
     bool thisisopt = (arg.compare(0,1,"-") == 0);
     if (thisisopt) {
       // set option to a standard undefined value and say that 
       // we expect (possibly) a value on next round
-      currentopt = arg;
-      __options[currentopt] = make_pair(int(iarg),-1);
-      __options_used[currentopt] = false;
+      currentopt = &__option_nodes.entry(options, arg);
+      if (currentopt->first > 0) __parsed->previous_occurrence[iarg] = currentopt->first;
+      *currentopt = make_pair(int(iarg),-1);
+      __options_used_nodes.entry(__options_used, arg) = false;
       next_may_be_val = true;}
     else {
       // otherwise throw away the argument for now...
       next_may_be_val = false;
-      currentopt = "";
+      currentopt = nullptr;
     }
   }
+  return true;
+}
+
+//----------------------------------------------------------------------
+CmdLine & CmdLine::reset(const vector<string> & args) {
+  if (args.size() == 0 || args[0].size() == 0 || args[0][0] == '-') {
+    throw Error("CmdLine::reset: args[0] should contain a command name");
+  }
+
+  // the parsed arguments can only be reused if they are not shared
+  // with clones or subcommands
+  if (!__parsed || __parsed.use_count() > 1) {
+    __parsed = std::make_shared<Parsed>();
+  } else {
+    __option_nodes.recycle(__parsed->options);
+    __parsed->end_of_options = -1;
+  }
+  __options_used_nodes.recycle(__options_used);
+  // assign element by element, so that each string reuses its buffer
+  vector<string> & arguments = __parsed->arguments;
+  arguments.resize(args.size());
+  for (size_t iarg = 0; iarg < args.size(); iarg++) arguments[iarg].assign(args[iarg]);
+
+  __override_arguments.clear();
+  __override_options.clear();
+  __override_command_line.clear();
+  __shadowed_options.clear();
+  __subcommands.clear();
+  __subcommand_name.clear();
+  __subcommand.reset();
+  __sweep_index = -1;
+  __sweep_size = 1;
+  __sweep_size_requested = false;
+  for (auto & opt_and_help: __options_help) opt_and_help.second.result_ptr.reset();
+
+  __parse_arguments(nullptr);
+  __update_help_flags();
+  return *this;
+}
+
+//----------------------------------------------------------------------
+namespace {
+  /// the CmdLine objects available to CmdLine::pooled on this thread
+  thread_local std::vector<std::unique_ptr<CmdLine>> cmdline_pool;
+  const size_t max_cmdline_pool_size = 8;
+}
+
+CmdLine::Pooled CmdLine::pooled(const vector<string> & args) {
+  if (cmdline_pool.size() == 0) return Pooled(std::unique_ptr<CmdLine>(new CmdLine(args)));
+  std::unique_ptr<CmdLine> cmdline = std::move(cmdline_pool.back());
+  cmdline_pool.pop_back();
+  cmdline->reset(args);
+  return Pooled(std::move(cmdline));
+}
+
+CmdLine::Pooled::~Pooled() {
+  if (_cmdline && cmdline_pool.size() < max_cmdline_pool_size) cmdline_pool.push_back(std::move(_cmdline));
+}
+
+//----------------------------------------------------------------------
+namespace {
+  // the options for getting help, registered by __register_help_options
+  // and looked up again by __update_help_flags
+  const char * const help_options[]          = {"-h", "-help", "--help"};
+  const char * const markdown_help_options[] = {"--markdown-help", "-markdown-help"};
+  const char * const completion_option       = "--cmdline-completion";
+  const char * const schema_option           = "--cmdline-schema";
+}
+
+bool CmdLine::__register_help_options(ParseError * error) {
   if (__help_enabled) {
     start_section("Options for getting help");
-    __help_requested = any_present({"-h","-help","--help"}).help("prints this help message").no_dump();
-    __markdown_help = any_present({"--markdown-help","-markdown-help"}).help("prints this help message in markdown format").no_dump();
+    __help_requested = any_present(help_options).help("prints this help message").no_dump();
+    __markdown_help = any_present(markdown_help_options).help("prints this help message in markdown format").no_dump();
     __help_requested |= __markdown_help;
+    auto completion = optional_value<string>(completion_option).argname("shell").no_dump()
+      .help("prints a completion script for the given shell (bash, zsh or fish) and exits");
+    // the choices are recorded (for the help and the completion itself), but checked
+    // below, since Result::choices(...) would require a value
+    completion.opthelp().choices = {"bash", "zsh", "fish"};
+    if (completion.present()) {
+      __completion_shell = completion.value();
+      if (__completion_shell != "bash" && __completion_shell != "zsh" && __completion_shell != "fish") {
+        if (error) {
+          *error = ParseError(ParseError::bad_value, completion_option, 
+                              internal_present(completion_option).second, __completion_shell);
+          return false;
+        }
+        throw Error("--cmdline-completion value should be one of bash, zsh or fish, but got " + __completion_shell);
+      }
+      // behave as for help, so that required options need not be supplied
+      __help_requested = true;
+    }
+    __schema_requested = present(schema_option).no_dump()
+      .help("prints a JSON description of the options (e.g. for cmdline-validate) and exits");
+    __help_requested |= __schema_requested;
     end_section();
   }
+  return true;
+}
 
-  // by default, enabe the git info
-  set_git_info_enabled(true);
+//----------------------------------------------------------------------
+void CmdLine::__update_help_flags() {
+  if (!__help_enabled) return;
+  __help_requested = false;
+  __markdown_help = false;
+  __completion_shell.clear();
+  // the options are registered, so marking them as used suffices
+  __markdown_help    = internal_present(markdown_help_options).first > 0;
+  __schema_requested = internal_present(schema_option).first > 0;
+  __help_requested   = internal_present(help_options).first > 0 || __markdown_help || __schema_requested;
+  pair<int,int> completion = internal_present(completion_option);
+  if (completion.second > 0) {
+    __arguments_used[completion.second] = true;
+    __completion_shell = __argument(completion.second);
+    if (__completion_shell != "bash" && __completion_shell != "zsh" && __completion_shell != "fish") {
+      throw Error("--cmdline-completion value should be one of bash, zsh or fish, but got " + __completion_shell);
+    }
+    __help_requested = true;
+  }
+}
+
+//----------------------------------------------------------------------
+void CmdLine::__append_quoted(string & str, const string & arg) {
+  // an argument made only of characters that no shell treats specially
+  // is written as it is; any other is enclosed in single quotes, inside
+  // which everything is literal, with a single quote written as '\''
+  // (close, escaped quote, reopen). Either way it parses back to the
+  // same argument, both in a POSIX shell and with tokenize().
+  static const char * plain_chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                    "0123456789_@%+=:,./-";
+  if (arg.size() != 0 && arg.find_first_not_of(plain_chars) == string::npos) {
+    str += arg;
+    return;
+  }
+  str += '\'';
+  for (char c: arg) {
+    if (c == '\'') str += "'\\''";
+    else            str += c;
+  }
+  str += '\'';
+}
+
+//----------------------------------------------------------------------
+string CmdLine::__quoted(const string & arg) {
+  string result;
+  __append_quoted(result, arg);
+  return result;
+}
+
+//----------------------------------------------------------------------
+CmdLine CmdLine::with_overrides(const vector<pair<string,string>> & overrides) const {
+  CmdLine result;
+  result.__parsed                = __parsed;
+  result.__override_arguments    = __override_arguments;
+  result.__override_options      = __override_options;
+  result.__override_command_line = __override_command_line;
+  result.__shadowed_options      = __shadowed_options;
+  for (const auto & opt_val: overrides) {
+    const string & opt = opt_val.first;
+    if (opt.compare(0,1,"-") != 0) throw Error("with_overrides: option '" + opt + "' does not start with a -");
+    const pair<int,int> * location = result.__find_option(opt);
+    if (location) result.__shadowed_options.push_back(*location);
+    int iopt = result.__n_arguments();
+    int ival = -1;
+    result.__override_arguments.push_back(opt);
+    result.__override_command_line += __quoted(opt) + " ";
+    if (opt_val.second != "") {
+      ival = iopt + 1;
+      result.__override_arguments.push_back(opt_val.second);
+      result.__override_command_line += __quoted(opt_val.second) + " ";
+    }
+    result.__override_options[opt] = make_pair(iopt, ival);
+  }
+
+  result.__arguments_used.resize(result.__n_arguments(), false);
+  result.__arguments_used[0] = true;
+  // shadowed options, and their values, should not be reported as unused;
+  // a value is recognised as one if it does not look like an option
+  for (const auto & location: result.__shadowed_options) {
+    result.__arguments_used[location.first] = true;
+    if (location.second > 0) {
+      const string & val = result.__argument(location.second);
+      if (val[0] != '-' || (val.size() > 1 && (isdigit(val[1]) || val[1] == '.'))) {
+        result.__arguments_used[location.second] = true;
+      }
+    }
+  }
+
+  // carry over the configuration, but not the queries made on this CmdLine
+  result.__help_enabled         = __help_enabled;
+  result.__git_info_enabled     = __git_info_enabled;
+  result.__time_at_start        = __time_at_start;
+  result.__start_steady_ns      = __start_steady_ns;
+  result.__start_system_ns      = __start_system_ns;
+  result.__timings              = __timings;
+  result.__overall_help_string  = __overall_help_string;
+  result.__fussy                = __fussy;
+  result.__section_descriptions = __section_descriptions;
+  result.__argfile_option       = __argfile_option;
+  result.__sweep_index          = __sweep_index;
+  result.__sweep_size           = __sweep_size;
+  result.__sweep_size_requested = __sweep_size_requested;
+  result.__register_help_options();
+  return result;
+}
+
+//----------------------------------------------------------------------
+bool CmdLine::__expand_sweep(ParseError * error) {
+  // problems are recorded in *error (with the full message as its
+  // value) or thrown, according to whether error is null
+  auto fail = [error](const string & option, const string & message) {
+    if (!error) throw Error(message);
+    *error = ParseError(ParseError::bad_sweep, option, -1, message);
+    return false;
+  };
+  vector<string> & arguments = __parsed->arguments;
+  bool zip = false;
+  bool index_found = false;
+  string index_string;
+  for (size_t iarg = 1; iarg < arguments.size(); ) {
+    const string & arg = arguments[iarg];
+    if (arg == _sweep_index_option) {
+      if (iarg+1 == arguments.size()) return fail(arg, "Option " + arg + " is passed but no index was given");
+      index_string = arguments[iarg+1];
+      index_found = true;
+      arguments.erase(arguments.begin()+iarg, arguments.begin()+iarg+2);
+    } else if (arg == _sweep_size_option) {
+      __sweep_size_requested = true;
+      arguments.erase(arguments.begin()+iarg);
+    } else if (arg == _sweep_zip_option) {
+      zip = true;
+      arguments.erase(arguments.begin()+iarg);
+    } else {
+      iarg++;
+    }
+  }
+  if (!index_found && !__sweep_size_requested) {
+    if (zip) return fail(_sweep_zip_option, "Option " + _sweep_zip_option + " requires " + _sweep_index_option
+                                            + " or " + _sweep_size_option + " to be present too");
+    return true;
+  }
+
+  // the sweep itself throws on invalid swept arguments; when errors
+  // are to be recorded, the exception is caught without printing
+  std::unique_ptr<Sweep> sweep;
+  {
+    QuietErrors quiet(error != nullptr);
+    try {
+      sweep.reset(new Sweep(arguments, zip));
+    } catch (const Error & sweep_error) {
+      if (!error) throw;
+      return fail("", sweep_error.message());
+    }
+  }
+  __sweep_size  = sweep->size();
+  __sweep_index = 0;
+  if (index_found) {
+    if (!CmdLine_try_string_to_value<long long>(index_string, __sweep_index)) {
+      return fail(_sweep_index_option, "could not convert value of option " + _sweep_index_option 
+                                       + " = \"" + index_string + "\" to an integer");
+    }
+    if (__sweep_index < 0 || uint64_t(__sweep_index) >= __sweep_size) {
+      return fail(_sweep_index_option, "sweep index " + index_string + " is out of range: the sweep has " 
+                                       + to_string(__sweep_size) + " points");
+    }
+  }
+  arguments = sweep->arguments(__sweep_index);
+  return true;
 }
 
 // indicates whether an option is present
-CmdLine::Result<bool> CmdLine::any_present(const vector<string> & opts) const {
-  OptionHelp * opthelp = opthelp_ptr(OptionHelp_present(opts));
+CmdLine::Result<bool> CmdLine::any_present(const OptionNames & opts) const {
+  OptionHelp * opthelp = opthelp_ptr(opts, OptKind::present, "", [&]{return OptionHelp_present(opts);});
   pair<int,int> result_pair = internal_present(opts);
   bool result = (result_pair.first > 0);
-  Result<bool> res(result, opthelp, result);
-  if (opthelp) opthelp->result_ptr = std::make_shared<Result<bool>>(res);
-  return res;
+  return __record_result(opthelp, Result<bool>(result, opthelp, result, OptKind::present));
 }
 
 //CmdLine::Result<bool> CmdLine::value_bool(const std::string & opt, const bool defval) const {
-CmdLine::Result<bool> CmdLine::any_value_bool(const std::vector<std::string> & opts, const bool defval) const {
-    OptionHelp * opthelp = opthelp_ptr(OptionHelp_value_with_default<bool>(opts, defval));
+CmdLine::Result<bool> CmdLine::any_value_bool(const OptionNames & opts, const bool defval) const {
+  OptionHelp * opthelp = opthelp_ptr(opts, OptKind::value_with_default, CmdLine_value_to_string(defval),
+                                     [&]{return OptionHelp_value_with_default<bool>(opts, defval);});
+  if (opthelp) opthelp->value_is_optional = true;
   pair<int,int> result_opt    = internal_present(opts);
-  std::vector<std::string> no_opts;
-  for (const auto & opt: opts) {no_opts.push_back("-no" + opt);}
-  pair<int,int> result_no_opt = internal_present(no_opts);
+
+  // the negations, -no<opt>, are assembled in a local buffer when they
+  // fit, so that they can be looked up without any memory allocation
+  const size_t max_local_negations = 4;
+  char buffer[256];
+  OptionName local_negations[max_local_negations];
+  size_t negations_size = 0;
+  for (size_t i = 0; i < opts.size(); i++) negations_size += 3 + opts[i].size();
+  pair<int,int> result_no_opt;
+  if (opts.size() <= max_local_negations && negations_size <= sizeof(buffer)) {
+    char * negation = buffer;
+    for (size_t i = 0; i < opts.size(); i++) {
+      memcpy(negation, "-no", 3);
+      memcpy(negation + 3, opts[i].data(), opts[i].size());
+      local_negations[i] = OptionName(negation, 3 + opts[i].size());
+      negation += 3 + opts[i].size();
+    }
+    result_no_opt = internal_present(OptionNames(local_negations, opts.size()));
+  } else {
+    vector<string> negations;
+    for (size_t i = 0; i < opts.size(); i++) negations.push_back("-no" + opts[i].str());
+    result_no_opt = internal_present(negations);
+  }
   bool result;
   bool is_present = true;
   if (result_opt.first > 0) {
     if (result_no_opt.first > 0) {
-      throw Error("boolean option " + __arguments[result_opt.first] 
-            + " and negation " + __arguments[result_no_opt.first]  + " are both present");
+      throw Error("boolean option " + __argument(result_opt.first) 
+            + " and negation " + __argument(result_no_opt.first)  + " are both present");
     } else if (result_opt.second > 0) {
-      const string & arg = __arguments[result_opt.second];
+      const string & arg = __argument(result_opt.second);
       // if next value starts with a - then it's an option, not a value
       if (arg[0] == '-') {
         result = true;
       } else  {
-        result = internal_value<bool>(__arguments[result_opt.first]);
+        result = internal_value<bool>(__argument(result_opt.first));
       }
     } else {
       result = true;
@@ -244,39 +601,55 @@ CmdLine::Result<bool> CmdLine::any_value_bool(const std::vector<std::string> & o
     result = defval;
     is_present = false;
   }
-  auto res = std::make_shared<Result<bool>>(result, opthelp, is_present);
-  if (opthelp) opthelp->result_ptr = res;
-  return *res;
+  return __record_result(opthelp, Result<bool>(result, opthelp, is_present, OptKind::value_with_default));
 }
 
-// indicates whether an option is present (for internal use only -- does not set help)
-pair<int,int> CmdLine::internal_present(const string & opt) const {
-  bool result = (__options.find(opt) != __options.end());
-  if (result) {
-    __options_used[opt] = true;
-    __arguments_used[__options[opt].first] = true;
-    return __options[opt];
-  } else {
-    return make_pair(-1,-1);
+// returns the location of an option and its possible value, or nullptr if it is absent
+const pair<int,int> * CmdLine::__find_option(OptionName opt) const {
+  // in a query through a Scope, the options of the scope are in its index
+  OptionName suffix;
+  if (__scope_index && __scope_index->in_scope(opt, suffix)) return __scope_index->find_option(suffix);
+  if (__override_options.size() != 0) {
+    auto iter = __override_options.find(opt);
+    if (iter != __override_options.end()) return &iter->second;
   }
+  auto iter = __parsed->options.find(opt);
+  if (iter != __parsed->options.end()) return &iter->second;
+  return nullptr;
+}
+
+// records that opt has been requested
+void CmdLine::__set_option_used(OptionName opt) const {
+  auto iter = __options_used.find(opt);
+  if (iter != __options_used.end()) iter->second = true;
+  else                              __options_used.emplace(opt.str(), true);
 }
 
 // indicates whether an option is present (for internal use only -- does not set help)
-pair<int,int> CmdLine::internal_present(const vector<string> & opts) const {
-  vector<string> opts_present;
-  for (const auto & opt: opts) {
-    bool opt_present = (__options.find(opt) != __options.end());
-    if (opt_present) opts_present.push_back(opt);
-  }
-
-  if      (opts_present.size() == 0) return make_pair(-1,-1);
-  else if (opts_present.size() == 1) {
-    __options_used[opts_present[0]] = true;
-    __arguments_used[__options[opts_present[0]].first] = true;
-    return __options[opts_present[0]];
+pair<int,int> CmdLine::internal_present(const OptionNames & opts) const {
+  size_t n_present = 0, ipresent = 0;
+  const pair<int,int> * location = nullptr;
+  for (size_t i = 0; i < opts.size(); i++) {
+    const pair<int,int> * opt_location = __find_option(opts[i]);
+    if (opt_location) {
+      n_present++;
+      ipresent = i;
+      location = opt_location;
+    }
+  }
+
+  if      (n_present == 0) return make_pair(-1,-1);
+  else if (n_present == 1) {
+    __set_option_used(opts[ipresent]);
+    __arguments_used[location->first] = true;
+    return *location;
   } else {
     // options are supposed to be mutually exclusive, so eliminate
     // them all
+    vector<string> opts_present;
+    for (size_t i = 0; i < opts.size(); i++) {
+      if (__find_option(opts[i])) opts_present.push_back(opts[i].str());
+    }
     ostringstream ostr;
     ostr << "Options " << opts_present[0];
     for (size_t i = 1; i < opts_present.size()-1; i++) {
@@ -288,35 +661,382 @@ pair<int,int> CmdLine::internal_present(const vector<string> & opts) const {
 }
 
 
+// returns the locations of all occurrences of any of the options
+vector<pair<int,int>> CmdLine::internal_present_all(const OptionNames & opts) const {
+  vector<pair<int,int>> result;
+  int n_parsed = __parsed->arguments.size();
+  for (size_t i = 0; i < opts.size(); i++) {
+    OptionName opt = opts[i];
+    auto override_iter = __override_options.find(opt);
+    if (override_iter != __override_options.end()) {
+      result.push_back(override_iter->second);
+    } else {
+      auto iter = __parsed->options.find(opt);
+      if (iter == __parsed->options.end()) continue;
+      // walk back through the earlier occurrences; each of them is
+      // followed by its possible value (cf. init())
+      for (int iarg = iter->second.first; iarg >= 0; iarg = __parsed->previous_occurrence[iarg]) {
+        result.push_back(make_pair(iarg, iarg+1 < n_parsed ? iarg+1 : -1));
+      }
+    }
+    __set_option_used(opt);
+  }
+  sort(result.begin(), result.end());
+  for (const auto & location: result) __arguments_used[location.first] = true;
+  return result;
+}
+
+//----------------------------------------------------------------------
+CmdLine::Result<CmdLine::ArgView> CmdLine::positional_view(const string & name, unsigned min_count, 
+                                                           unsigned max_count) const {
+  OptionHelp * opthelp = opthelp_ptr(OptionHelp_positional<string>(name, min_count, max_count));
+  return __record_result(opthelp, Result<ArgView>(__positional_view(name, min_count, max_count), opthelp, true, OptKind::positional));
+}
+
+// returns a view of the positional arguments
+CmdLine::ArgView CmdLine::__positional_view(const string & name, unsigned min_count, unsigned max_count) const {
+  if (name.compare(0,1,"-") == 0) throw Error("name of positional argument, " + name + ", should not start with a -");
+
+  ArgView view;
+  view._args = std::shared_ptr<const vector<string>>(__parsed, &__parsed->arguments);
+  const vector<string> & arguments = __parsed->arguments;
+  int end_of_options = __parsed->end_of_options;
+  int n_before = end_of_options >= 0 ? end_of_options : arguments.size();
+  auto is_opt = [&](int iarg) {return arguments[iarg].compare(0,1,"-") == 0;};
+
+  // before the end of the options, an argument is positional if it is
+  // not an option and has not been used as a value; and if the preceding
+  // argument is an option, that option must have been used without
+  // taking this argument as its value
+  for (int iarg = 1; iarg < n_before; iarg++) {
+    if (is_opt(iarg) || __arguments_used[iarg]) continue;
+    if (iarg > 1 && is_opt(iarg-1) && !__arguments_used[iarg-1]) continue;
+    view._push_back(iarg);
+  }
+  // after the end of the options, all arguments are positional
+  if (end_of_options >= 0) {
+    __arguments_used[end_of_options] = true;
+    for (int iarg = end_of_options+1; iarg < int(arguments.size()); iarg++) view._push_back(iarg);
+  }
+  for (const auto & run: view._runs) {
+    for (int iarg = run.first; iarg < run.second; iarg++) __arguments_used[iarg] = true;
+  }
+
+  if (!__help_requested && (view.size() < min_count || view.size() > max_count)) {
+    ostringstream ostr;
+    ostr << "found " << view.size() << " positional " << name << " argument(s), but expected ";
+    if      (max_count == any_count)  ostr << "at least " << min_count;
+    else if (min_count == max_count)  ostr << "exactly " << min_count;
+    else                              ostr << "between " << min_count << " and " << max_count;
+    throw Error(ostr);
+  }
+  return view;
+}
+
+std::string CmdLine_value_to_string(const CmdLine::ArgView & view) {
+  string result;
+  for (const auto & arg: view) {
+    if (result.size() != 0) result += " ";
+    result += arg;
+  }
+  return result;
+}
+
+std::vector<std::string> CmdLine_values_to_strings(const CmdLine::ArgView & view) {
+  return vector<string>(view.begin(), view.end());
+}
+
+void CmdLine::ArgView::_push_back(int iarg) {
+  if (_runs.size() != 0 && _runs.back().second == iarg) _runs.back().second++;
+  else _runs.push_back(make_pair(iarg, iarg+1));
+  _size++;
+}
+
+const std::string & CmdLine::ArgView::operator[](size_t i) const {
+  return (*_args)[position(i)];
+}
+
+int CmdLine::ArgView::position(size_t i) const {
+  if (i >= _size) throw Error("ArgView index " + to_string(i) + " out of range (size = " + to_string(_size) + ")");
+  for (const auto & run: _runs) {
+    size_t run_size = run.second - run.first;
+    if (i < run_size) return run.first + i;
+    i -= run_size;
+  }
+  return -1; // not reached
+}
+
+//----------------------------------------------------------------------
+int CmdLine::__subcommand_position() const {
+  const vector<string> & arguments = __parsed->arguments;
+  int end_of_options = __parsed->end_of_options;
+  int n_before = end_of_options >= 0 ? end_of_options : arguments.size();
+  auto is_opt = [&](int iarg) {return arguments[iarg].compare(0,1,"-") == 0;};
+  // same criteria as for positional arguments
+  for (int iarg = 1; iarg < n_before; iarg++) {
+    if (is_opt(iarg) || __arguments_used[iarg]) continue;
+    if (iarg > 1 && is_opt(iarg-1) && !__arguments_used[iarg-1]) continue;
+    return iarg;
+  }
+  return -1;
+}
+
+bool CmdLine::subcommand(const string & name, const string & help,
+                         const std::function<void(CmdLine &)> & registration) {
+  __subcommands.push_back(make_pair(name, help));
+  if (__subcommand) return false;
+  int position = __subcommand_position();
+  if (position < 0 || __parsed->arguments[position] != name) return false;
+
+  // the arguments from the subcommand onwards belong to the nested CmdLine
+  const vector<string> & arguments = __parsed->arguments;
+  vector<string> sub_arguments;
+  sub_arguments.reserve(arguments.size() - position);
+  sub_arguments.push_back(arguments[0]);
+  sub_arguments.insert(sub_arguments.end(), arguments.begin()+position+1, arguments.end());
+  for (size_t iarg = position; iarg < arguments.size(); iarg++) __arguments_used[iarg] = true;
+
+  // remove them from the index of options of this CmdLine, falling back to
+  // earlier occurrences where they exist
+  // (on a private copy of the parsed arguments, since they may be shared
+  // with clones and views, which should still see all the arguments)
+  if (__parsed.use_count() > 1) __parsed = std::make_shared<Parsed>(*__parsed);
+  auto & options = __parsed->options;
+  for (auto iter = options.begin(); iter != options.end(); ) {
+    int iarg = iter->second.first;
+    while (iarg >= position) iarg = __parsed->previous_occurrence[iarg];
+    if (iarg < 0) {
+      __options_used.erase(iter->first);
+      iter = options.erase(iter);
+    } else {
+      iter->second = make_pair(iarg, iarg+1 < position ? iarg+1 : -1);
+      ++iter;
+    }
+  }
+  if (__parsed->end_of_options > position) __parsed->end_of_options = -1;
+
+  // help (or completion) requested after the subcommand is for the
+  // subcommand, so the help flags are redetermined from the remaining options
+  __update_help_flags();
+
+  __subcommand = std::make_shared<CmdLine>(sub_arguments, __help_enabled, __argfile_option);
+  __subcommand->__subcommand_of = name;
+  __subcommand->__parsed->command_line = command_line();
+  __subcommand->set_git_info_enabled(__git_info_enabled);
+  __subcommand->__time_at_start   = __time_at_start;
+  __subcommand->__start_steady_ns = __start_steady_ns;
+  __subcommand->__start_system_ns = __start_system_ns;
+  __subcommand->__timings         = __timings;
+  __subcommand_name = name;
+  if (help.size() != 0) __subcommand->help(help);
+  registration(*__subcommand);
+  return true;
+}
+
+CmdLine & CmdLine::subcommand_cmdline() const {
+  if (!__subcommand) throw Error("CmdLine::subcommand_cmdline() called, but no subcommand was selected");
+  return *__subcommand;
+}
+
+CmdLine::Scope CmdLine::scope(const string & prefix) const {
+  return Scope(this, prefix);
+}
+
+namespace {
+  /// ordering of option names, for the sorted vectors of a ScopeIndex
+  bool name_less(CmdLine::OptionName a, CmdLine::OptionName b) {
+    int result = memcmp(a.data(), b.data(), std::min(a.size(), b.size()));
+    return result < 0 || (result == 0 && a.size() < b.size());
+  }
+  bool name_equal(CmdLine::OptionName a, CmdLine::OptionName b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size()) == 0;
+  }
+  /// for searching the sorted (name, value) pairs of a ScopeIndex
+  struct FirstNameLess {
+    template<class P> bool operator()(const P & entry, CmdLine::OptionName name) const {
+      return name_less(entry.first, name);
+    }
+  };
+}
+
+bool CmdLine::ScopeIndex::in_scope(OptionName name, OptionName & suffix) const {
+  if (name.size() < prefix.size() || prefix.compare(0, prefix.size(), name.data(), prefix.size()) != 0) return false;
+  suffix = OptionName(name.data() + prefix.size(), name.size() - prefix.size());
+  return true;
+}
+
+const pair<int,int> * CmdLine::ScopeIndex::find_option(OptionName suffix) const {
+  auto iter = std::lower_bound(options.begin(), options.end(), suffix, FirstNameLess());
+  if (iter == options.end() || !name_equal(iter->first, suffix)) return nullptr;
+  return &iter->second;
+}
+
+CmdLine::OptionHelp * CmdLine::ScopeIndex::find_help(OptionName suffix) const {
+  auto iter = std::lower_bound(help.begin(), help.end(), suffix, FirstNameLess());
+  if (iter == help.end() || !name_equal(iter->first, suffix)) return nullptr;
+  return iter->second;
+}
+
+CmdLine::Scope::Scope(const CmdLine * cmdline, const string & prefix, const ScopeIndex * parent) 
+  : _cmdline(cmdline) {
+  _index.prefix = prefix;
+  if (parent) {
+    // the options and help of a nested scope are among those of its
+    // parent, in the same order, with a longer part of the name removed
+    OptionName name(prefix.data() + parent->prefix.size(), prefix.size() - parent->prefix.size());
+    auto nested = [&](OptionName suffix, OptionName & nested_suffix) {
+      if (suffix.size() < name.size() || memcmp(suffix.data(), name.data(), name.size()) != 0) return false;
+      nested_suffix = OptionName(suffix.data() + name.size(), suffix.size() - name.size());
+      return true;
+    };
+    OptionName nested_suffix;
+    for (const auto & entry: parent->options) {
+      if (nested(entry.first, nested_suffix)) _index.options.emplace_back(nested_suffix, entry.second);
+    }
+    for (const auto & entry: parent->help) {
+      if (nested(entry.first, nested_suffix)) _index.help.emplace_back(nested_suffix, entry.second);
+    }
+    _index.parsed = parent->parsed;
+  } else {
+    // the help of options queried before (e.g. through an earlier scope
+    // with the same prefix) is contiguous in the ordered map of the help
+    OptionName suffix;
+    for (auto iter = cmdline->__options_help.lower_bound(prefix); 
+         iter != cmdline->__options_help.end() && _index.in_scope(iter->first, suffix); iter++) {
+      _index.help.emplace_back(suffix, &iter->second);
+    }
+  }
+  _update_index();
+}
+
+CmdLine::Scope CmdLine::Scope::scope(const string & name) const {
+  _update_index();
+  return Scope(_cmdline, _index.prefix + name, &_index);
+}
+
+void CmdLine::Scope::_update_index() const {
+  if (_index.parsed == _cmdline->__parsed) return;
+  _index.parsed = _cmdline->__parsed;
+  auto & options = _index.options;
+  options.clear();
+  // the options starting with the prefix are contiguous in the ordered
+  // maps, and the overrides replace the parsed options of the same name
+  OptionName suffix;
+  const OptionMap<pair<int,int>> & parsed_options = _index.parsed->options;
+  for (auto iter = parsed_options.lower_bound(_index.prefix); 
+       iter != parsed_options.end() && _index.in_scope(iter->first, suffix); iter++) {
+    options.emplace_back(suffix, iter->second);
+  }
+  const OptionMap<pair<int,int>> & overrides = _cmdline->__override_options;
+  for (auto iter = overrides.lower_bound(_index.prefix); 
+       iter != overrides.end() && _index.in_scope(iter->first, suffix); iter++) {
+    auto position = std::lower_bound(options.begin(), options.end(), suffix, FirstNameLess());
+    if (position != options.end() && name_equal(position->first, suffix)) position->second = iter->second;
+    else options.emplace(position, suffix, iter->second);
+  }
+}
+
+CmdLine::OptionName CmdLine::Scope::_full_name(const string & name, char * buffer, size_t buffer_size, 
+                                               string & long_name) const {
+  const string & prefix = _index.prefix;
+  if (prefix.size() + name.size() > buffer_size) {
+    long_name = prefix + name;
+    return long_name;
+  }
+  memcpy(buffer, prefix.data(), prefix.size());
+  memcpy(buffer + prefix.size(), name.data(), name.size());
+  return OptionName(buffer, prefix.size() + name.size());
+}
+
+void CmdLine::Scope::_record_help(OptionHelp & opthelp) const {
+  opthelp.scope = _index.prefix;
+  OptionName suffix;
+  if (!_index.in_scope(opthelp.option, suffix)) return;
+  auto position = std::lower_bound(_index.help.begin(), _index.help.end(), suffix, FirstNameLess());
+  if (position == _index.help.end() || !name_equal(position->first, suffix)) {
+    _index.help.emplace(position, suffix, &opthelp);
+  }
+}
+
+namespace {
+  /// true if str matches pattern, in which '*' matches any sequence of
+  /// characters (with backtracking only to the last '*')
+  bool matches_pattern(const string & str, const string & pattern) {
+    size_t istr = 0, ipat = 0, star = string::npos, star_str = 0;
+    while (istr < str.size()) {
+      if (ipat < pattern.size() && pattern[ipat] == '*') {
+        star = ipat++;
+        star_str = istr;
+      } else if (ipat < pattern.size() && pattern[ipat] == str[istr]) {
+        ipat++; istr++;
+      } else if (star != string::npos) {
+        ipat = star + 1;
+        istr = ++star_str;
+      } else {
+        return false;
+      }
+    }
+    while (ipat < pattern.size() && pattern[ipat] == '*') ipat++;
+    return ipat == pattern.size();
+  }
+}
+
+vector<string> CmdLine::options_matching(const string & pattern) const {
+  const string prefix = pattern.substr(0, pattern.find('*'));
+  vector<string> result;
+  // the options starting with the prefix are contiguous in the ordered maps
+  auto add_matches = [&](const OptionMap<pair<int,int>> & options) {
+    for (auto iter = options.lower_bound(prefix); 
+         iter != options.end() && iter->first.compare(0, prefix.size(), prefix) == 0; iter++) {
+      if (matches_pattern(iter->first, pattern)) result.push_back(iter->first);
+    }
+  };
+  add_matches(__parsed->options);
+  if (__override_options.size() != 0) {
+    add_matches(__override_options);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+  }
+  return result;
+}
+
+vector<string> CmdLine::Scope::options() const {
+  _update_index();
+  vector<string> result;
+  result.reserve(_index.options.size());
+  for (const auto & entry: _index.options) result.push_back(entry.first.str());
+  return result;
+}
+
 // indicates whether an option is present and has a value associated
-bool CmdLine::internal_present_and_set(const string & opt) const {
-  pair<int,int> is_present = internal_present(opt);
+bool CmdLine::internal_present_and_set(const OptionNames & opts) const {
+  pair<int,int> is_present = internal_present(opts);
   return (is_present.second > 0);
 
 }
 
 
 // return the string value corresponding to the specified option
-string CmdLine::internal_string_val(const vector<string> & opts) const {
+const string & CmdLine::internal_string_val(const OptionNames & opts) const {
   pair<int,int> is_present = internal_present(opts);
   if (is_present.second < 0) {
     if (opts.size() == 1) {
-      throw Error("Option " +opts[0]+ " requested but not present and set");
+      throw Error("Option " +opts[0].str()+ " requested but not present and set");
     } else {
       ostringstream ostr;
-      ostr << "One of the options " << opts[0];
+      ostr << "One of the options " << opts[0].str();
       for (size_t i = 1; i < opts.size()-1; i++) {
-        ostr << ", " << opts[i];
+        ostr << ", " << opts[i].str();
       }
-      ostr << " or " << opts[opts.size()-1] << " requested but none present and set";
+      ostr << " or " << opts[opts.size()-1].str() << " requested but none present and set";
       throw Error(ostr);
     }
   }
-  string arg = __arguments[is_present.second];
+  const string & arg = __argument(is_present.second);
   __arguments_used[is_present.second] = true;
   // this may itself look like an option -- if that is the case
   // declare the option to have been used
-  if (arg.compare(0,1,"-") == 0) {__options_used[arg] = true;}
+  if (arg.compare(0,1,"-") == 0) {__set_option_used(arg);}
   return arg;
 }
 
@@ -354,14 +1074,15 @@ void CmdLine::end_subsection(const std::string & subsection_name) {
 bool CmdLine::all_options_used(ostream & ostr) const {
   bool result = true;
   for (size_t iarg = 1; iarg < __arguments_used.size(); iarg++) {
-    string arg = __arguments[iarg];
+    string arg = __argument(iarg);
     bool this_one = __arguments_used[iarg];
     if (! this_one) {
       ostr << "\nArgument " << arg << " at position " << iarg << " unused/unrecognized";
       if (__options_used.count(arg) > 0 && __options_used[arg]) {
         ostr << "  (this could be because the same option already appeared";
-        if (__options.count(arg) && __options[arg].first > 0) {
-          ostr << " at position " << __options[arg].first << ")";
+        const pair<int,int> * location = __find_option(arg);
+        if (location && location->first > 0) {
+          ostr << " at position " << location->first << ")";
         } else {
           ostr << " elsewhere on the command line)";
         }
@@ -388,15 +1109,167 @@ string CmdLine::time_stamp_at_start(bool utc) const {
 /// return the elapsed time in seconds since the CmdLine object was
 /// created
 double CmdLine::time_elapsed_since_start() const {
-  time_t timenow;
-  time(&timenow);
-  return std::difftime(timenow, __time_at_start);
+  return 1e-9 * ns_elapsed_since_start();
+}
+
+//----------------------------------------------------------------------
+// timing of phases
+namespace {
+  int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+  /// a small integer identifying the current thread in traces
+  int trace_thread_id() {
+    static std::atomic<int> n_threads{0};
+    thread_local int id = ++n_threads;
+    return id;
+  }
+}
+
+struct CmdLine::Timings {
+  struct Record {
+    std::string name;
+    int64_t start_ns;    ///< relative to the start of the CmdLine
+    int64_t duration_ns;
+    int thread;
+  };
+  std::mutex mutex;
+  std::vector<Record> records;
+};
+
+void CmdLine::__record_start_time() {
+  time(&__time_at_start);
+  __start_steady_ns = steady_ns();
+  __start_system_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch()).count();
+  // the records are cleared (rather than replaced) when reparsing, so
+  // that their storage is reused, unless they are shared with a clone
+  if (__timings && __timings.use_count() == 1) {
+    __timings->records.clear();
+  } else {
+    __timings = std::make_shared<Timings>();
+  }
+}
+
+int64_t CmdLine::ns_elapsed_since_start() const {return steady_ns() - __start_steady_ns;}
+
+CmdLine::PhaseTimer CmdLine::phase(const string & name) const {
+  if (!__timings) throw Error("CmdLine::phase(\"" + name + "\") called on a CmdLine without arguments");
+  return PhaseTimer(__timings, name, __start_steady_ns);
+}
+
+CmdLine::PhaseTimer::PhaseTimer(const std::shared_ptr<Timings> & timings, const string & name, 
+                                int64_t origin_steady_ns) : 
+  _timings(timings), _name(name), _origin_steady_ns(origin_steady_ns), _start_steady_ns(steady_ns()) {}
+
+CmdLine::PhaseTimer::PhaseTimer(PhaseTimer && other) noexcept : 
+  _timings(std::move(other._timings)), _name(std::move(other._name)), 
+  _origin_steady_ns(other._origin_steady_ns), _start_steady_ns(other._start_steady_ns), 
+  _stop_steady_ns(other._stop_steady_ns) {}
+
+void CmdLine::PhaseTimer::stop() {
+  // a moved-from or already stopped timer records nothing
+  if (!_timings || _stop_steady_ns >= 0) return;
+  _stop_steady_ns = steady_ns();
+  std::lock_guard<std::mutex> lock(_timings->mutex);
+  _timings->records.push_back(Timings::Record{_name, _start_steady_ns - _origin_steady_ns,
+                                              _stop_steady_ns - _start_steady_ns, trace_thread_id()});
+}
+
+double CmdLine::PhaseTimer::elapsed() const {
+  return 1e-9 * ((_stop_steady_ns >= 0 ? _stop_steady_ns : steady_ns()) - _start_steady_ns);
+}
+
+string CmdLine::phase_summary(const string & prefix) const {
+  // totals per phase name, in order of first start
+  struct Total {string name; int64_t first_start_ns; int64_t total_ns; long count;};
+  vector<Total> totals;
+  if (__timings) {
+    std::lock_guard<std::mutex> lock(__timings->mutex);
+    for (const auto & record: __timings->records) {
+      auto total = std::find_if(totals.begin(), totals.end(), 
+                                [&record](const Total & t) {return t.name == record.name;});
+      if (total == totals.end()) {
+        totals.push_back(Total{record.name, record.start_ns, record.duration_ns, 1});
+      } else {
+        total->first_start_ns = std::min(total->first_start_ns, record.start_ns);
+        total->total_ns += record.duration_ns;
+        total->count++;
+      }
+    }
+  }
+  std::stable_sort(totals.begin(), totals.end(), 
+                   [](const Total & a, const Total & b) {return a.first_start_ns < b.first_start_ns;});
+
+  size_t width = 0;
+  for (const auto & total: totals) width = std::max(width, total.name.size());
+  ostringstream ostr;
+  char line[64];
+  for (const auto & total: totals) {
+    snprintf(line, sizeof(line), "%12.6f s  (%ld %s)", 1e-9 * total.total_ns, 
+             total.count, total.count == 1 ? "call" : "calls");
+    ostr << prefix << "phase " << total.name << ": " << string(width - total.name.size(), ' ') << line << endl;
+  }
+  snprintf(line, sizeof(line), "%.6f s", time_elapsed_since_start());
+  ostr << prefix << "Elapsed time since start: " << line << endl;
+  return ostr.str();
+}
+
+string CmdLine::chrome_trace() const {
+  ostringstream ostr;
+  ostr << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  ostr << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << getpid() 
+       << ", \"args\": {\"name\": \"" << __json_escaped(command_name()) << "\"}}";
+  if (__timings) {
+    std::lock_guard<std::mutex> lock(__timings->mutex);
+    char times[64];
+    for (const auto & record: __timings->records) {
+      // times in microseconds, with ns precision
+      snprintf(times, sizeof(times), "\"ts\": %.3f, \"dur\": %.3f", 
+               1e-3 * record.start_ns, 1e-3 * record.duration_ns);
+      ostr << ",\n  {\"name\": \"" << __json_escaped(record.name) << "\", \"cat\": \"phase\", \"ph\": \"X\", "
+           << times << ", \"pid\": " << getpid() << ", \"tid\": " << record.thread << "}";
+    }
+  }
+  ostr << "\n]}\n";
+  return ostr.str();
+}
+
+void CmdLine::write_chrome_trace(const string & filename) const {
+  ofstream out(filename);
+  if (!out.good()) throw Error("could not open " + filename + " to write the Chrome trace");
+  out << chrome_trace();
+  if (!out.good()) throw Error("could not write the Chrome trace to " + filename);
+}
+
+string CmdLine::__json_escaped(const string & str) {
+  string result;
+  result.reserve(str.size());
+  for (char c: str) {
+    switch (c) {
+    case '"':  result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\n': result += "\\n"; break;
+    case '\t': result += "\\t"; break;
+    case '\r': result += "\\r"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+        result += escaped;
+      } else {
+        result += c;
+      }
+    }
+  }
+  return result;
 }
 
 
 /// convert the time into a string (local by default -- utc if 
 /// utc=true).
-string CmdLine::_string_time(const time_t & time, bool utc) const {
+string CmdLine::_string_time(const time_t & time, bool utc) {
   struct tm * timeinfo;
   if (utc) {
     timeinfo = gmtime(&time);
@@ -453,11 +1326,34 @@ void CmdLine::_report_conversion_failure(const string & opt,
 }
 
 void CmdLine::assert_all_options_used() const {
-  // deal with the help part
+  // deal with shell completion and the help part
+  if (__help_enabled && __completion_shell.size() != 0) {
+    cout << completion_script(__completion_shell);
+    exit(0);
+  }
+  if (__help_enabled && __schema_requested) {
+    cout << schema();
+    exit(0);
+  }
   if (__help_enabled && __help_requested) {
     print_help(cout, __markdown_help);
     exit(0);
   }
+  if (__sweep_size_requested) {
+    cout << __sweep_size << endl;
+    exit(0);
+  }
+  if (__subcommand) {
+    __subcommand->assert_all_options_used();
+  } else if (__subcommands.size() != 0) {
+    int position = __subcommand_position();
+    if (position >= 0) {
+      ostringstream ostr;
+      ostr << "Unknown subcommand " << __parsed->arguments[position] << "; available subcommands are:";
+      for (const auto & sub: __subcommands) ostr << " " << sub.first;
+      throw Error(ostr);
+    }
+  }
   ostringstream ostr;
   if (! all_options_used(ostr)) {
     ostr <<"Unrecognised options on the command line" << endl;
@@ -495,41 +1391,285 @@ double CmdLine::double_val(const string & opt, const double & defval) const {
 
 // return the full command line including the command itself
 string CmdLine::command_line() const {
-  return __command_line;
+  return __parsed->command_line + __override_command_line;
+}
+
+const std::vector<std::string> & CmdLine::arguments() const {
+  if (__override_arguments.size() == 0) return __parsed->arguments;
+  if (int(__all_arguments.size()) != __n_arguments()) {
+    __all_arguments = __parsed->arguments;
+    __all_arguments.insert(__all_arguments.end(), __override_arguments.begin(), __override_arguments.end());
+  }
+  return __all_arguments;
+}
+
+
+
+bool CmdLine::Error::_do_printout = true;
+CmdLine::Error::Error(const std::ostringstream & ostr) : CmdLine::Error(ostr.str()) {}
+
+  CmdLine::Error::Error(const std::string & str) 
+  : std::runtime_error(str) {
+  _message = what();
+  if (_do_printout && quiet_errors == 0) cerr << tc::red << tc::bold 
+                         << "CmdLine Error: " << tc::nobold << _message << tc::reset << endl;
+}
+
+//----------------------------------------------------------------------
+string CmdLine::ParseError::message() const {
+  switch (_code) {
+  case none: 
+    return "";
+  case bad_quoting:
+    return "unterminated quote at character " + to_string(_position) + " of \"" + _value + "\"";
+  case bad_command_name:
+    return "CmdLine::try_parse: args[0] = '" + _value + "' should contain a command name (non-empty, not starting with a -)";
+  case argfile_not_found:
+    return "Option " + _option + " is passed but no file was found";
+  case bad_sweep:
+    return _value;
+  case bad_value:
+    return "invalid value \"" + _value + "\" for option " + _option;
+  case option_absent:
+    return "Option " + _option + " requested but not present and set";
+  case value_absent:
+    return "option " + _option + " present, but expected value was absent";
+  case conversion_failure:
+    return "could not convert value of option \"" + _option + "\" = \"" + _value + "\", to requested type (" 
+           + (_type_name ? OptionHelp::demangle(_type_name) : string("unknown")) + ")";
+  }
+  return "unknown error";
+}
+
+string CmdLine::current_path() const {
+  const size_t maxlen = 10000;
+  char tmp[maxlen];
+  char * result = getcwd(tmp,maxlen);
+  if (result == nullptr) {
+    return "error-getting-path";
+  } else {
+    return string(tmp);
+  }
+}
+
+string CmdLine::header(const string & prefix) const {
+  ostringstream ostr;
+  ostr << prefix << "" << command_line() << endl;
+  ostr << prefix << "from path: " << current_path() << endl;
+  ostr << prefix << "started at: " << time_stamp_at_start() << endl;
+  ostr << prefix << "by user: "    << unix_username() << endl;
+  ostr << prefix << "running on: " << unix_uname() << endl;
+  ostr << prefix << "git state (if any): " << git_info() << endl;
+  if (__sweep_index >= 0) {
+    ostr << prefix << "sweep point: " << __sweep_index << " (of " << __sweep_size << ")" << endl;
+  }
+  ostr << prefix << "configuration fingerprint: " << fingerprint() << endl;
+  // information about content referred to by option values (e.g. list files)
+  for (const auto & opt: __options_queried) {
+    const OptionHelp & opthelp = __options_help.at(opt);
+    if (!opthelp.result_ptr || !opthelp.result_ptr->has_value()) continue;
+    string note = opthelp.result_ptr->value_annotation();
+    if (note.size() == 0) continue;
+    ostr << prefix << opt << " " << opthelp.result_ptr->value_as_string() << ": " << note << endl;
+  }
+  return ostr.str();
+}
+
+namespace {
+  /// the value of the entry "name:" in a /proc file with lines of the
+  /// form "name: value [unit]", or -1 if the file or entry is absent
+  int64_t proc_entry(const string & filename, const string & name) {
+    ifstream file(filename);
+    string line;
+    while (getline(file, line)) {
+      if (line.size() > name.size() && line.compare(0, name.size(), name) == 0 
+          && line[name.size()] == ':') {
+        return strtoll(line.c_str() + name.size() + 1, nullptr, 10);
+      }
+    }
+    return -1;
+  }
+
+  /// the number of bytes, in a form that is easy to read
+  string human_bytes(int64_t bytes) {
+    if (bytes < 0) return "n/a";
+    const char * units[] = {"B", "kB", "MB", "GB", "TB"};
+    double value = bytes;
+    unsigned iunit = 0;
+    while (value >= 1024 && iunit + 1 < sizeof(units)/sizeof(units[0])) {value /= 1024; iunit++;}
+    char result[32];
+    if (iunit == 0) snprintf(result, sizeof(result), "%lld B", static_cast<long long>(bytes));
+    else            snprintf(result, sizeof(result), "%.1f %s", value, units[iunit]);
+    return result;
+  }
+
+  /// state for CmdLine::footer_at_exit()
+  struct FooterAtExit {
+    std::mutex mutex;
+    bool registered = false;
+    string prefix;
+    int64_t start_steady_ns = 0;
+  };
+  FooterAtExit & footer_at_exit_state() {
+    static FooterAtExit * state = new FooterAtExit; // never destroyed, so usable at exit
+    return *state;
+  }
+}
+
+CmdLine::ResourceUsage CmdLine::resource_usage() {
+  ResourceUsage usage;
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0) {
+    usage.user_cpu_s   = ru.ru_utime.tv_sec + 1e-6 * ru.ru_utime.tv_usec;
+    usage.system_cpu_s = ru.ru_stime.tv_sec + 1e-6 * ru.ru_stime.tv_usec;
+#ifdef __APPLE__
+    usage.peak_rss_bytes = ru.ru_maxrss;        // in bytes on macOS
+#else
+    usage.peak_rss_bytes = 1024 * int64_t(ru.ru_maxrss); // in kB elsewhere
+#endif
+    usage.major_faults = ru.ru_majflt;
+    usage.minor_faults = ru.ru_minflt;
+    usage.voluntary_context_switches   = ru.ru_nvcsw;
+    usage.involuntary_context_switches = ru.ru_nivcsw;
+  }
+  // on Linux, /proc has the peak RSS to the kB and the I/O counts
+  int64_t vm_hwm_kb = proc_entry("/proc/self/status", "VmHWM");
+  if (vm_hwm_kb >= 0) usage.peak_rss_bytes = 1024 * vm_hwm_kb;
+  usage.read_bytes            = proc_entry("/proc/self/io", "rchar");
+  usage.written_bytes         = proc_entry("/proc/self/io", "wchar");
+  usage.storage_read_bytes    = proc_entry("/proc/self/io", "read_bytes");
+  usage.storage_written_bytes = proc_entry("/proc/self/io", "write_bytes");
+  return usage;
+}
+
+string CmdLine::__footer(const string & prefix, int64_t start_steady_ns) {
+  ResourceUsage usage = resource_usage();
+  time_t timenow;
+  time(&timenow);
+  auto count = [](int64_t n) {return n < 0 ? string("n/a") : to_string(n);};
+  char line[128];
+  ostringstream ostr;
+  ostr << prefix << "finished at: " << _string_time(timenow, false) << endl;
+  snprintf(line, sizeof(line), "%.3f s", 1e-9 * (steady_ns() - start_steady_ns));
+  ostr << prefix << "elapsed time: " << line << endl;
+  snprintf(line, sizeof(line), "%.3f s user, %.3f s system", usage.user_cpu_s, usage.system_cpu_s);
+  ostr << prefix << "CPU time: " << line << endl;
+  ostr << prefix << "peak memory (RSS): " << human_bytes(usage.peak_rss_bytes) << endl;
+  ostr << prefix << "page faults: " << count(usage.major_faults) << " major, " 
+                                    << count(usage.minor_faults) << " minor" << endl;
+  ostr << prefix << "I/O: " << human_bytes(usage.read_bytes) << " read (" 
+       << human_bytes(usage.storage_read_bytes) << " from storage), "
+       << human_bytes(usage.written_bytes) << " written ("
+       << human_bytes(usage.storage_written_bytes) << " to storage)" << endl;
+  ostr << prefix << "context switches: " << count(usage.voluntary_context_switches) << " voluntary, " 
+       << count(usage.involuntary_context_switches) << " involuntary" << endl;
+  return ostr.str();
+}
+
+string CmdLine::footer(const string & prefix) const {
+  return __footer(prefix, __start_steady_ns);
+}
+
+void CmdLine::footer_at_exit(const string & prefix) const {
+  FooterAtExit & state = footer_at_exit_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.prefix = prefix;
+  state.start_steady_ns = __start_steady_ns;
+  if (state.registered) return;
+  state.registered = true;
+  atexit([](){
+    FooterAtExit & exit_state = footer_at_exit_state();
+    std::lock_guard<std::mutex> exit_lock(exit_state.mutex);
+    cout << __footer(exit_state.prefix, exit_state.start_steady_ns) << flush;
+  });
+}
+
+namespace {
+  /// incremental 128-bit FNV-1a hash
+  class FNV1a128 {
+  public:
+    void add(const char * data, size_t n) {
+      for (size_t i = 0; i < n; i++) {
+        _lo ^= uint64_t(static_cast<unsigned char>(data[i]));
+        // multiply by the FNV prime 2^88 + 0x13b, modulo 2^128
+        uint64_t lo_lo = (_lo & 0xffffffffULL) * 0x13bULL;
+        uint64_t lo_hi = (_lo >> 32) * 0x13bULL;
+        uint64_t carry = (lo_hi + (lo_lo >> 32)) >> 32;
+        _hi = _hi * 0x13bULL + carry + (_lo << 24);
+        _lo = _lo * 0x13bULL;
+      }
+    }
+    /// adds the string preceded by its length, so that the boundaries
+    /// between successive strings are part of the hash
+    void add(const string & str) {
+      unsigned char length[8];
+      for (unsigned i = 0; i < 8; i++) length[i] = static_cast<unsigned char>(uint64_t(str.size()) >> (8*i));
+      add(reinterpret_cast<const char *>(length), sizeof(length));
+      add(str.data(), str.size());
+    }
+    /// the hash in hexadecimal, after a bijective mixing of its bits, since
+    /// FNV-1a spreads changes in the last bytes over few of the high bits
+    /// (and similar configurations should differ in their leading digits)
+    string hex() const {
+      uint64_t lo = fmix64(_lo ^ _hi);
+      uint64_t hi = fmix64(_hi ^ lo);
+      char result[33];
+      snprintf(result, sizeof(result), "%016llx%016llx", 
+               static_cast<unsigned long long>(hi), static_cast<unsigned long long>(lo));
+      return result;
+    }
+  private:
+    /// the MurmurHash3 finaliser, which is invertible
+    static uint64_t fmix64(uint64_t k) {
+      k ^= k >> 33; k *= 0xff51afd7ed558ccdULL;
+      k ^= k >> 33; k *= 0xc4ceb9fe1a85ec53ULL;
+      k ^= k >> 33;
+      return k;
+    }
+    uint64_t _hi = 0x6c62272e07bb0142ULL, _lo = 0x62b821756295c58dULL;
+  };
 }
 
-
-
-bool CmdLine::Error::_do_printout = true;
-CmdLine::Error::Error(const std::ostringstream & ostr) : CmdLine::Error(ostr.str()) {}
-
-  CmdLine::Error::Error(const std::string & str) 
-  : std::runtime_error(str) {
-  _message = what();
-  if (_do_printout) cerr << tc::red << tc::bold 
-                         << "CmdLine Error: " << tc::nobold << _message << tc::reset << endl;
+vector<string> CmdLine::__fingerprint_entries() const {
+  vector<string> entries;
+  for (const auto & opt: __options_queried) {
+    const OptionHelp & opthelp = __options_help.at(opt);
+    if (opthelp.no_dump || !opthelp.result_ptr) continue;
+    const ResultBase & res = *opthelp.result_ptr;
+    // fields separated by a character that cannot otherwise appear
+    string entry = opthelp.option + '\0' + opthelp.type + '\0' + (res.present() ? "1" : "0");
+    // as in dump(), absent optional values have no value
+    if (opthelp.kind != OptKind::optional_value || res.present()) {
+      for (const auto & value: res.values_as_strings()) entry += '\0' + value;
+      string note = res.value_annotation();
+      if (note.size() != 0) entry += string("\0#", 2) + note;
+    }
+    entries.push_back(std::move(entry));
+  }
+  if (__subcommand) {
+    for (const auto & entry: __subcommand->__fingerprint_entries()) {
+      entries.push_back("subcommand " + __subcommand_name + '\0' + entry);
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+  return entries;
 }
 
-string CmdLine::current_path() const {
-  const size_t maxlen = 10000;
-  char tmp[maxlen];
-  char * result = getcwd(tmp,maxlen);
-  if (result == nullptr) {
-    return "error-getting-path";
-  } else {
-    return string(tmp);
-  }
+string CmdLine::fingerprint() const {
+  FNV1a128 hash;
+  for (const auto & entry: __fingerprint_entries()) hash.add(entry);
+  return hash.hex();
 }
 
-string CmdLine::header(const string & prefix) const {
-  ostringstream ostr;
-  ostr << prefix << "" << command_line() << endl;
-  ostr << prefix << "from path: " << current_path() << endl;
-  ostr << prefix << "started at: " << time_stamp_at_start() << endl;
-  ostr << prefix << "by user: "    << unix_username() << endl;
-  ostr << prefix << "running on: " << unix_uname() << endl;
-  ostr << prefix << "git state (if any): " << git_info() << endl;
-  return ostr.str();
+bool CmdLine::fingerprint_exists(const string & filename) const {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0) return false;
+  // map the file afresh (rather than via __mapped_file), since outputs
+  // may have been rewritten while the program runs
+  MappedFile file(filename);
+  const string tag = "configuration fingerprint: " + fingerprint();
+  const char * end = file.data() + file.size();
+  return std::search(file.data(), end, tag.begin(), tag.end()) != end;
 }
 
 /// return a pointer to an existing opthelp is the option is present
@@ -538,40 +1678,50 @@ string CmdLine::header(const string & prefix) const {
 CmdLine::OptionHelp * CmdLine::opthelp_ptr(const CmdLine::OptionHelp & opthelp) const {
   if (!__help_enabled) return nullptr;
 
-  OptionHelp * result;
-
-  auto opthelp_iter = __options_help.find(opthelp.option);
-  if (opthelp_iter == __options_help.end()) {
+  OptionHelp * result = __registered_opthelp(opthelp.option, opthelp.kind, opthelp.default_value);
+  if (!result) {
     __options_queried.push_back(opthelp.option);
-    __options_help[opthelp.option] = opthelp;
-    result = &__options_help[opthelp.option];
-  } else {
-    result = &opthelp_iter->second;
-    // now create a lambda to help with checks that
-    // - the option is not being redefined with a different kind
-    // - the option is not being redefined with a different default value
-    auto warn_or_fail = [&](const string & message) {
-      if (fussy()) throw Error(message);
-      else         cout << "********* CmdLine warning: " << message << endl;
-    };
-    if (result->kind != opthelp.kind) {
-      ostringstream ostr;
-      ostr << "Option " << opthelp.option << " has already been requested with kind '" 
-           << result->kind << "' but is now being requested with kind '" << opthelp.kind << "'";
-      warn_or_fail(ostr.str());
-    }
-    if (result->kind == OptKind::value_with_default && result->default_value != opthelp.default_value) {
-      ostringstream ostr;
-      ostr << "Option " << opthelp.option << " has already been requested with default value " 
-           << result->default_value << " but is now being requested with default_value " << opthelp.default_value;
-      warn_or_fail(ostr.str());      
-    }
+    result = &__options_help.emplace(opthelp.option, opthelp).first->second;
   }
   return result;
 
 }
 
-const CmdLine::OptionHelp * CmdLine::existing_opthelp_ptr(const std::string & opt) const {
+/// return a pointer to the opthelp already registered for option, if
+/// any, checking that
+/// - the option is not being redefined with a different kind
+/// - the option is not being redefined with a different default value
+CmdLine::OptionHelp * CmdLine::__registered_opthelp(OptionName option, OptKind kind, 
+                                                    const std::string & default_value) const {
+  // in a query through a Scope, the help may already be in its index
+  OptionHelp * result = nullptr;
+  OptionName suffix;
+  if (__scope_index && __scope_index->in_scope(option, suffix)) result = __scope_index->find_help(suffix);
+  if (!result) {
+    auto opthelp_iter = __options_help.find(option);
+    if (opthelp_iter == __options_help.end()) return nullptr;
+    result = &opthelp_iter->second;
+  }
+  auto warn_or_fail = [&](const string & message) {
+    if (fussy()) throw Error(message);
+    else         cout << "********* CmdLine warning: " << message << endl;
+  };
+  if (result->kind != kind) {
+    ostringstream ostr;
+    ostr << "Option " << result->option << " has already been requested with kind '" 
+         << result->kind << "' but is now being requested with kind '" << kind << "'";
+    warn_or_fail(ostr.str());
+  }
+  if (result->kind == OptKind::value_with_default && result->default_value != default_value) {
+    ostringstream ostr;
+    ostr << "Option " << result->option << " has already been requested with default value " 
+         << result->default_value << " but is now being requested with default_value " << default_value;
+    warn_or_fail(ostr.str());      
+  }
+  return result;
+}
+
+const CmdLine::OptionHelp * CmdLine::existing_opthelp_ptr(OptionName opt) const {
   auto opthelp_iter = __options_help.find(opt);
   if (opthelp_iter != __options_help.end()) return &opthelp_iter->second;
 
@@ -617,10 +1767,15 @@ string CmdLine::OptionHelp::demangle(const std::string & type_name) {
 
 string CmdLine::OptionHelp::summary() const {
   ostringstream ostr;
+  if (kind == OptKind::positional) {
+    ostr << (required ? "" : "[") << option << "..." << (required ? "" : "]");
+    return ostr.str();
+  }
   if (! required) ostr << "[";
   ostr << option;
   if (takes_value) ostr << " " << argname;
   if (! required) ostr << "]";
+  if (kind == OptKind::all_values) ostr << "...";
   return ostr.str();
 }
 
@@ -644,9 +1799,15 @@ string CmdLine::OptionHelp::description(const string & prefix, int wrap_column,
 
   bool itemised_choices = false;
 
-  if (takes_value) {
+  if (kind == OptKind::positional) {
+    ostr << " (" << type_name() << "), positional arguments";
+    if      (max_count == any_count) {if (min_count > 0) ostr << ", at least " << min_count;}
+    else if (min_count == max_count) ostr << ", exactly " << min_count;
+    else                             ostr << ", between " << min_count << " and " << max_count;
+  } else if (takes_value) {
     ostr << " " << italic_code(argname) << " (" << type_name() << ")";
     if (has_default) ostr << ", default: " << code(default_value);
+    if (kind == OptKind::all_values) ostr << ", may be repeated";
     if (choices.size() != 0) {
       string choice_list_str = choice_list(code);
       // some arbitrary limit on the length of the list of choices
@@ -666,10 +1827,10 @@ string CmdLine::OptionHelp::description(const string & prefix, int wrap_column,
     }
     ostr << "  \n";
   }
+  // (no empty line without help, which would not carry the prefix in a dump)
   if (help.size() > 0) {
-    ostr << wrap(help, wrap_column, prefix + "  ");
+    ostr << wrap(help, wrap_column, prefix + "  ") << endl;
   } 
-  ostr << endl;
 
   // finish off with any itemised choices
   if (itemised_choices) {
@@ -805,10 +1966,38 @@ std::vector<CmdLine::OptSection> CmdLine::organised_options() const {
     }
   }
 
+  // within each (sub)section, the options of a scope are listed together,
+  // at the position of the first of them
+  for (auto & opt_section: opt_sections) {
+    vector<const OptionHelp *> & options = opt_section.options;
+    map<string, vector<const OptionHelp *>> scope_options;
+    for (const auto & opthelp: options) {
+      if (opthelp->scope.size() != 0) scope_options[opthelp->scope].push_back(opthelp);
+    }
+    if (scope_options.size() == 0) continue;
+    vector<const OptionHelp *> grouped;
+    grouped.reserve(options.size());
+    for (const auto & opthelp: options) {
+      if (opthelp->scope.size() == 0) {
+        grouped.push_back(opthelp);
+        continue;
+      }
+      // the first option of a scope brings all the others with it
+      vector<const OptionHelp *> & in_scope = scope_options[opthelp->scope];
+      grouped.insert(grouped.end(), in_scope.begin(), in_scope.end());
+      in_scope.clear();
+    }
+    options.swap(grouped);
+  }
+
   return opt_sections;
 
 }
 
+void CmdLine::print_help() const {print_help(cout);}
+void CmdLine::print_markdown() const {print_markdown(cout);}
+bool CmdLine::all_options_used() const {return all_options_used(cerr);}
+
 void CmdLine::print_help(ostream & ostr, bool markdown) const {
   if (!__help_enabled) throw Error("CmdLine::print_help() called, but help disabled");
 
@@ -817,10 +2006,11 @@ void CmdLine::print_help(ostream & ostr, bool markdown) const {
     return;
   }
   // First print a summary
-  ostr << "\nUsage: \n       " << __arguments[0];
+  ostr << "\nUsage: \n       " << command_name();
   for (const auto & opt: __options_queried) {
     ostr << " " << __options_help[opt].summary();
   }
+  if (__subcommands.size() != 0) ostr << " subcommand [subcommand options]";
   ostr << endl << endl;
 
   if (__overall_help_string.size() != 0) {
@@ -828,6 +2018,17 @@ void CmdLine::print_help(ostream & ostr, bool markdown) const {
     ostr << endl << endl;
   }
 
+  if (__subcommands.size() != 0) {
+    ostr << "Subcommands" << endl;
+    ostr << "===========" << endl;
+    ostr << "(use " << command_name() << " subcommand -h for help on a subcommand's options)" << endl << endl;
+    for (const auto & sub: __subcommands) {
+      ostr << sub.first << endl;
+      if (sub.second.size() != 0) ostr << wrap(sub.second, 80, "  ") << endl;
+      ostr << endl;
+    }
+  }
+
   ostr << "Detailed option help" << endl;
   ostr << "====================" << endl << endl;
 
@@ -858,6 +2059,176 @@ void CmdLine::print_help(ostream & ostr, bool markdown) const {
 }
 
 
+//------------------------------------------------------------------------
+string CmdLine::schema() const {
+  auto json_strings = [](const vector<string> & strings) {
+    string result = "[";
+    for (size_t i = 0; i < strings.size(); i++) {
+      result += (i == 0 ? "\"" : ", \"") + __json_escaped(strings[i]) + "\"";
+    }
+    return result + "]";
+  };
+  ostringstream ostr;
+  ostr << "{\n  \"cmdline_schema\": 1,\n"
+       << "  \"program\": \"" << __json_escaped(command_name()) << "\",\n"
+       << "  \"argfile_option\": \"" << __json_escaped(__argfile_option) << "\",\n";
+  vector<string> subcommands;
+  for (const auto & sub: __subcommands) subcommands.push_back(sub.first);
+  ostr << "  \"subcommands\": " << json_strings(subcommands) << ",\n"
+       << "  \"options\": [";
+  bool first = true;
+  for (const auto & opt: __options_queried) {
+    const OptionHelp & opthelp = __options_help.at(opt);
+    ostr << (first ? "\n" : ",\n") << "    {\"option\": \"" << __json_escaped(opthelp.option) << "\""
+         << ", \"aliases\": " << json_strings(opthelp.aliases)
+         << ", \"kind\": \"" << opthelp.kind << "\""
+         << ", \"type\": \"" << __json_escaped(opthelp.kind == OptKind::present ? "" : opthelp.type_name()) << "\""
+         << ", \"required\": " << (opthelp.required ? "true" : "false");
+    if (opthelp.value_is_optional) ostr << ", \"optional_value\": true";
+    if (opthelp.has_default && opthelp.kind != OptKind::present) {
+      ostr << ", \"default\": \"" << __json_escaped(opthelp.default_value) << "\"";
+    }
+    if (opthelp.choices.size() != 0) ostr << ", \"choices\": " << json_strings(opthelp.choices);
+    if (opthelp.range_strings.size() == 2) ostr << ", \"range\": " << json_strings(opthelp.range_strings);
+    if (opthelp.kind == OptKind::positional) {
+      ostr << ", \"min_count\": " << opthelp.min_count;
+      if (opthelp.max_count != any_count) ostr << ", \"max_count\": " << opthelp.max_count;
+    }
+    ostr << "}";
+    first = false;
+  }
+  ostr << "\n  ]\n}\n";
+  return ostr.str();
+}
+
+string CmdLine::completion_script(const string & shell) const {
+  // the completion is for a program, as installed with "complete" etc.,
+  // so it cannot be for a subcommand (whose command_name() is "prog sub")
+  if (__subcommand_of.size() != 0) {
+    throw Error("--cmdline-completion cannot be given after the subcommand " + __subcommand_of 
+                + "; give it before the subcommand, for the completion of the whole program");
+  }
+  // the command name as typed by the user, and a version usable in identifiers
+  string command = command_name();
+  if (command.find('/') != string::npos) command = command.substr(command.rfind('/')+1);
+  string ident = command;
+  for (auto & c: ident) {if (!isalnum(static_cast<unsigned char>(c))) c = '_';}
+
+  // a one-line description, without characters that the shells treat specially
+  auto short_help = [](const string & help) {
+    string result = help.substr(0, help.find('\n'));
+    if (result.size() > 70) result = result.substr(0, 67) + "...";
+    for (auto & c: result) {if (c == '\'' || c == '[' || c == ']' || c == ':' || c == '"' || c == '\\') c = ' ';}
+    return result;
+  };
+  auto names_of = [](const OptionHelp & opthelp) {
+    return opthelp.aliases.size() != 0 ? opthelp.aliases : vector<string>{opthelp.option};
+  };
+  auto joined = [](const vector<string> & strings, const string & separator) {
+    string result;
+    for (const auto & str: strings) result += (result.size() != 0 ? separator : "") + str;
+    return result;
+  };
+  vector<string> subcommands;
+  for (const auto & sub: __subcommands) subcommands.push_back(sub.first);
+
+  ostringstream ostr;
+  vector<OptSection> sections = organised_options();
+  if (shell == "bash") {
+    ostr << "# bash completion for " << command << ", generated by CmdLine" << endl;
+    ostr << "_" << ident << "_completion() {" << endl;
+    ostr << "  local cur=\"${COMP_WORDS[COMP_CWORD]}\" prev=\"${COMP_WORDS[COMP_CWORD-1]}\"" << endl;
+    ostr << "  case \"$prev\" in" << endl;
+    vector<string> words;
+    for (const auto & section: sections) {
+      if (section.level > 0) ostr << "    # " << section.name << endl;
+      for (const auto & opthelp: section.options) {
+        if (opthelp->kind == OptKind::positional) continue;
+        vector<string> names = names_of(*opthelp);
+        words.insert(words.end(), names.begin(), names.end());
+        if (!opthelp->takes_value) continue;
+        ostr << "    " << joined(names, "|") << ")" << endl;
+        if (opthelp->choices.size() != 0) {
+          ostr << "      COMPREPLY=( $(compgen -W \"" << joined(opthelp->choices, " ") << "\" -- \"$cur\") )" << endl;
+        } else {
+          ostr << "      # " << opthelp->argname << ": default (file) completion" << endl;
+          ostr << "      COMPREPLY=()" << endl;
+        }
+        ostr << "      return 0;;" << endl;
+      }
+    }
+    ostr << "  esac" << endl;
+    words.insert(words.end(), subcommands.begin(), subcommands.end());
+    ostr << "  COMPREPLY=( $(compgen -W \"" << joined(words, " ") << "\" -- \"$cur\") )" << endl;
+    ostr << "}" << endl;
+    ostr << "complete -o default -F _" << ident << "_completion " << command << endl;
+
+  } else if (shell == "zsh") {
+    ostr << "#compdef " << command << endl;
+    ostr << "# zsh completion for " << command << ", generated by CmdLine" << endl;
+    ostr << "_" << ident << "() {" << endl;
+    ostr << "  _arguments \\" << endl;
+    for (const auto & section: sections) {
+      for (const auto & opthelp: section.options) {
+        string action;
+        if (opthelp->takes_value) {
+          action = ":" + short_help(opthelp->argname) + ":";
+          if (opthelp->choices.size() != 0) action += "(" + joined(opthelp->choices, " ") + ")";
+          else                              action += "_files";
+        }
+        if (opthelp->kind == OptKind::positional) {
+          ostr << "    '*" << action << "' \\" << endl;
+          continue;
+        }
+        vector<string> names = names_of(*opthelp);
+        // repeatable options may appear several times, the others are
+        // excluded (together with their aliases) once present
+        string spec = "[" + short_help(opthelp->help) + "]" + action;
+        string exclusions = opthelp->kind == OptKind::all_values ? "*" : "(" + joined(names, " ") + ")";
+        if (names.size() == 1) ostr << "    '" << exclusions << names[0] << spec << "' \\" << endl;
+        else                   ostr << "    '" << exclusions << "'{" << joined(names, ",") << "}'" << spec << "' \\" << endl;
+      }
+    }
+    if (subcommands.size() != 0) {
+      ostr << "    '1:subcommand:(" << joined(subcommands, " ") << ")' \\" << endl;
+      ostr << "    '*::subcommand options:_files' \\" << endl;
+    }
+    ostr << "    && return 0" << endl;
+    ostr << "}" << endl;
+    ostr << "compdef _" << ident << " " << command << endl;
+
+  } else if (shell == "fish") {
+    ostr << "# fish completion for " << command << ", generated by CmdLine" << endl;
+    for (const auto & section: sections) {
+      if (section.level > 0) ostr << "# " << section.name << endl;
+      for (const auto & opthelp: section.options) {
+        if (opthelp->kind == OptKind::positional) continue;
+        ostr << "complete -c " << command;
+        for (const auto & name: names_of(*opthelp)) {
+          // fish distinguishes -x (short), --xyz (long) and -xyz (old-style) options
+          if      (name.compare(0,2,"--") == 0) ostr << " -l " << name.substr(2);
+          else if (name.size() == 2)            ostr << " -s " << name.substr(1);
+          else                                  ostr << " -o " << name.substr(1);
+        }
+        if (opthelp->takes_value) {
+          ostr << " -r";
+          if (opthelp->choices.size() != 0) ostr << " -f -a '" << joined(opthelp->choices, " ") << "'";
+        }
+        ostr << " -d '" << short_help(opthelp->help) << "'" << endl;
+      }
+    }
+    for (const auto & sub: __subcommands) {
+      ostr << "complete -c " << command << " -n __fish_use_subcommand -f -a " << sub.first 
+           << " -d '" << short_help(sub.second) << "'" << endl;
+    }
+
+  } else {
+    throw Error("CmdLine::completion_script: unknown shell " + shell + " (should be bash, zsh or fish)");
+  }
+  return ostr.str();
+}
+
+
 //------------------------------------------------------------------------
 void CmdLine::print_markdown(ostream & ostr) const {
   bool markdown = true;
@@ -868,13 +2239,13 @@ void CmdLine::print_markdown(ostream & ostr) const {
   };
 
   // First print a summary
-//  ostr << "\nUsage: \n       " << __arguments[0];
+//  ostr << "\nUsage: \n       " << command_name();
 //  for (const auto & opt: __options_queried) {
 //    ostr << " " << __options_help[opt].summary();
 //  }
 //  ostr << endl << endl;
 
-  ostr << "# " << code(__arguments[0]) << ": Option help" << endl << endl;;
+  ostr << "# " << code(command_name()) << ": Option help" << endl << endl;;
 
   ostr << "[//]: # (Generated by: " << command_line () << ")" << endl << endl;
 
@@ -943,19 +2314,49 @@ string CmdLine::dump(const string & prefix, const string & absence_prefix, const
   ostringstream ostr;
 
   ostr << prefix << "argfile for " << command_line() << endl;
-  if (!compact) ostr << wrap(__overall_help_string, 80, prefix) << endl;
+  ostr << prefix << "configuration fingerprint: " << fingerprint() << endl;
+  // (without an empty line when there is no help, so that read_dump()
+  // can take an empty line as the end of the dump)
+  if (!compact && __overall_help_string.size() != 0) ostr << wrap(__overall_help_string, 80, prefix) << endl;
   if (!compact) ostr << prefix << "generated by CmdLine::dump() on " << time_stamp() << endl;
 
+  // values that refer to external content (e.g. list files) are followed
+  // by a comment with information about that content
+  auto annotation = [&](const ResultBase & res) {
+    string note = res.value_annotation();
+    return note.size() == 0 ? note : "  # " + note;
+  };
+
+  // positional arguments are written at the end, after a "--", if any
+  // of them starts with '-' (cf. below)
+  ostringstream after_separator;
+
   auto print_option = [&](const OptionHelp & opthelp) {
+    // options not queried again since a reset() have no result
+    if (!opthelp.result_ptr) return;
     const ResultBase & res = *(opthelp.result_ptr);
     if (opthelp.kind == OptKind::present) {
       if (res.present()) ostr << opthelp.option << endl;
       else               ostr << absence_prefix << opthelp.option << endl;
     } else if (opthelp.kind == OptKind::optional_value) {
-      if (res.present()) ostr << presence_prefix << opthelp.option << " " << res.value_as_string() << endl;
+      if (res.present()) ostr << presence_prefix << opthelp.option << " " << res.value_as_string() << annotation(res) << endl;
       else               ostr << absence_prefix << opthelp.option << " " << opthelp.argname << endl;
+    } else if (opthelp.kind == OptKind::positional) {
+      // the positional arguments one per line; when read back, each is
+      // preceded by a value or by a (present) option, but one that starts
+      // with '-' would be taken for an option
+      vector<string> values = res.values_as_strings();
+      bool option_like = std::any_of(values.begin(), values.end(), 
+                                     [](const string & value) {return value.compare(0,1,"-") == 0;});
+      for (const auto & value: values) (option_like ? after_separator : ostr) << presence_prefix << value << endl;
+    } else if (opthelp.kind == OptKind::all_values) {
+      // one line per occurrence
+      if (!res.present()) ostr << absence_prefix << opthelp.option << " " << opthelp.argname << endl;
+      for (const auto & value: res.values_as_strings()) {
+        ostr << presence_prefix << opthelp.option << " " << value << endl;
+      }
     } else {      
-      ostr << presence_prefix << opthelp.option << " " << res.value_as_string() << endl;
+      ostr << presence_prefix << opthelp.option << " " << res.value_as_string() << annotation(res) << endl;
     }
   };
 
@@ -977,9 +2378,67 @@ string CmdLine::dump(const string & prefix, const string & absence_prefix, const
     }
   }
 
+  // everything after a "--" is positional when read back
+  if (after_separator.tellp() > 0) {
+    if (!compact) ostr << prefix << endl;
+    ostr << prefix << "positional arguments" << endl;
+    ostr << "--" << endl << after_separator.str();
+  }
+
+  // the subcommand and its options follow, so that the output can
+  // still be read back as an argfile
+  if (__subcommand) {
+    if (!compact) ostr << prefix << endl;
+    ostr << prefix << "subcommand" << endl;
+    ostr << __subcommand_name << endl;
+    ostr << __subcommand->dump(prefix, absence_prefix, presence_prefix, compact);
+  }
+
   return ostr.str();
 }
 
+vector<pair<string,string>> CmdLine::read_dump(std::istream & input, const string & prefix, 
+                                               size_t max_search_lines) {
+  vector<pair<string,string>> result;
+  const string start = prefix + "argfile for ";
+  string line;
+  // find the start of the dump
+  bool found = false;
+  for (size_t iline = 0; !found && iline < max_search_lines && getline(input, line); iline++) {
+    found = line.compare(0, start.size(), start) == 0;
+  }
+  if (!found) return result;
+
+  // then read options up to the end of the dump
+  const string subcommand_line = prefix + "subcommand";
+  string subcommand_prefix;
+  bool subcommand_next = false;
+  // (arguments after a "--" are positional, not options)
+  bool after_separator = false;
+  while (getline(input, line) && line.size() != 0) {
+    if (line == subcommand_line) {subcommand_next = true; after_separator = false; continue;}
+    if (line == "--") after_separator = true;
+    if (after_separator) continue;
+    if (prefix.size() != 0 && line.compare(0, prefix.size(), prefix) == 0) continue;
+    // split the line as an argfile is split, dropping comments
+    vector<string> tokens;
+    istringstream line_in(line);
+    string token;
+    while (line_in >> token && token.find("//") == string::npos && token.find("#") == string::npos) {
+      tokens.push_back(token);
+    }
+    if (tokens.size() == 0) continue;
+    if (subcommand_next) {
+      subcommand_prefix += tokens[0] + " ";
+      subcommand_next = false;
+    } else if (tokens[0].size() > 1 && tokens[0][0] == '-') {
+      string value;
+      for (size_t i = 1; i < tokens.size(); i++) value += (i == 1 ? "" : " ") + tokens[i];
+      result.emplace_back(subcommand_prefix + tokens[0], std::move(value));
+    }
+  }
+  return result;
+}
 
 // //------------------------------------------------------------------------
 // /// return a std::string in argfile format that contains all
@@ -1097,72 +2556,685 @@ template<> bool CmdLine_string_to_value<bool>(const std::string & str) {
   throw CmdLine::ConversionFailure(str);
 }
 
+//----------------------------------------------------------------------
+// non-throwing conversions, which accept the same strings as the
+// istringstream-based CmdLine_string_to_value (leading whitespace,
+// trailing characters after a valid number, wrap-around of negative
+// values for unsigned types, no inf/nan, no hexadecimal), but signal
+// failure through their return value
+
+/// signed integers, via strtoll
+template<class T> static bool _try_string_to_signed(const std::string & str, T & value) {
+  const char * begin = str.c_str();
+  char * end;
+  errno = 0;
+  long long result = strtoll(begin, &end, 10);
+  if (end == begin || errno == ERANGE || result < numeric_limits<T>::min() 
+      || result > numeric_limits<T>::max()) return false;
+  value = T(result);
+  return true;
+}
+
+/// unsigned integers, via strtoull on the magnitude
+template<class T> static bool _try_string_to_unsigned(const std::string & str, T & value) {
+  const char * begin = str.c_str();
+  while (isspace(static_cast<unsigned char>(*begin))) begin++;
+  bool negative = (*begin == '-');
+  if (negative || *begin == '+') begin++;
+  if (!isdigit(static_cast<unsigned char>(*begin))) return false;
+  char * end;
+  errno = 0;
+  unsigned long long result = strtoull(begin, &end, 10);
+  if (errno == ERANGE || result > numeric_limits<T>::max()) return false;
+  value = negative ? T(T(0) - T(result)) : T(result);
+  return true;
+}
+
+/// floating-point types, via strtod or strtof
+template<class T> static bool _try_string_to_floating(const std::string & str, T & value, 
+                                                      T (*convert)(const char *, char **)) {
+  const char * begin = str.c_str();
+  while (isspace(static_cast<unsigned char>(*begin))) begin++;
+  const char * digits = begin;
+  if (*digits == '-' || *digits == '+') digits++;
+  if (!isdigit(static_cast<unsigned char>(*digits)) && *digits != '.') return false;
+  // a hexadecimal prefix is read by istringstream as the number 0
+  if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+    value = (*begin == '-') ? -T(0) : T(0);
+    return true;
+  }
+  char * end;
+  errno = 0;
+  T result = convert(begin, &end);
+  if (end == begin) return false;
+  if (errno == ERANGE && std::fabs(result) == numeric_limits<T>::infinity()) return false;
+  // errno == ERANGE can also indicate subnormals, which istringstream accepts,
+  // but strtod's huge-value convention depends on the libc, so check for
+  // the largest finite values too
+  if (errno == ERANGE && std::fabs(result) == numeric_limits<T>::max()) return false;
+  value = result;
+  return true;
+}
+
+template<> bool CmdLine_try_string_to_value<int>(const std::string & str, int & value) {
+  return _try_string_to_signed(str, value);}
+template<> bool CmdLine_try_string_to_value<long>(const std::string & str, long & value) {
+  return _try_string_to_signed(str, value);}
+template<> bool CmdLine_try_string_to_value<long long>(const std::string & str, long long & value) {
+  return _try_string_to_signed(str, value);}
+template<> bool CmdLine_try_string_to_value<unsigned int>(const std::string & str, unsigned int & value) {
+  return _try_string_to_unsigned(str, value);}
+template<> bool CmdLine_try_string_to_value<unsigned long>(const std::string & str, unsigned long & value) {
+  return _try_string_to_unsigned(str, value);}
+template<> bool CmdLine_try_string_to_value<unsigned long long>(const std::string & str, unsigned long long & value) {
+  return _try_string_to_unsigned(str, value);}
+template<> bool CmdLine_try_string_to_value<float>(const std::string & str, float & value) {
+  return _try_string_to_floating<float>(str, value, strtof);}
+template<> bool CmdLine_try_string_to_value<double>(const std::string & str, double & value) {
+  return _try_string_to_floating<double>(str, value, strtod);}
+template<> bool CmdLine_try_string_to_value<string>(const std::string & str, string & value) {
+  value = str;
+  return true;
+}
+template<> bool CmdLine_try_string_to_value<bool>(const std::string & str, bool & value) {
+  // the accepted strings are few and short, so compare case-insensitively in place
+  auto equals = [&str](const char * candidate) {
+    size_t n = strlen(candidate);
+    if (str.size() != n) return false;
+    for (size_t i = 0; i < n; i++) {
+      if (std::tolower(static_cast<unsigned char>(str[i])) != candidate[i]) return false;
+    }
+    return true;
+  };
+  for (const char * candidate: {"1", "yes", "on", "true", ".true."}) {
+    if (equals(candidate)) {value = true; return true;}
+  }
+  for (const char * candidate: {"0", "no", "off", "false", ".false."}) {
+    if (equals(candidate)) {value = false; return true;}
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------
+// conversions of values to strings
+#if defined(__cpp_lib_to_chars)
+/// shortest round-trip representation, via std::to_chars
+template<class T> static string _floating_to_string(T value, const char *, T (*)(const char *, char **)) {
+  char buffer[64];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  return string(buffer, result.ptr);
+}
+#else
+/// shortest round-trip representation, found by increasing the number
+/// of digits until the value converts back exactly (with strto_T)
+template<class T> static string _floating_to_string(T value, const char * format, 
+                                                    T (*strto_T)(const char *, char **)) {
+  if (value != value) return "nan";
+  char buffer[64];
+  for (int digits = numeric_limits<T>::digits10; digits <= numeric_limits<T>::max_digits10; digits++) {
+    snprintf(buffer, sizeof(buffer), format, digits, value);
+    if (strto_T(buffer, nullptr) == value) break;
+  }
+  return buffer;
+}
+#endif
+
+#if __cplusplus >= 201703L
+template<class T> static string _integer_to_string(T value) {
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  return string(buffer, result.ptr);
+}
+#else
+template<class T> static string _integer_to_string(T value) {return std::to_string(value);}
+#endif
+
+template<> std::string CmdLine_value_to_string<float>(const float & value) {
+  return _floating_to_string(value, "%.*g", strtof);}
+template<> std::string CmdLine_value_to_string<double>(const double & value) {
+  return _floating_to_string(value, "%.*g", strtod);}
+template<> std::string CmdLine_value_to_string<long double>(const long double & value) {
+  return _floating_to_string(value, "%.*Lg", strtold);}
+template<> std::string CmdLine_value_to_string<int>(const int & value) {
+  return _integer_to_string(value);}
+template<> std::string CmdLine_value_to_string<unsigned int>(const unsigned int & value) {
+  return _integer_to_string(value);}
+template<> std::string CmdLine_value_to_string<long>(const long & value) {
+  return _integer_to_string(value);}
+template<> std::string CmdLine_value_to_string<unsigned long>(const unsigned long & value) {
+  return _integer_to_string(value);}
+template<> std::string CmdLine_value_to_string<long long>(const long long & value) {
+  return _integer_to_string(value);}
+template<> std::string CmdLine_value_to_string<unsigned long long>(const unsigned long long & value) {
+  return _integer_to_string(value);}
+template<> std::string CmdLine_value_to_string<string>(const std::string & value) {return value;}
+
 std::vector<std::string> CmdLine::split_at_spaces(const std::string & str) {
   vector<string> result;
-  stringstream ss(str);
-  string item;
-  while (getline(ss, item, ' ')) {
+  size_t start = 0;
+  while (start < str.size()) {
+    size_t stop = str.find(' ', start);
+    if (stop == string::npos) stop = str.size();
     // skip empty items, effectively ignoring multiple spaces
-    if (item == "") continue;
-    result.push_back(item);
+    if (stop != start) result.emplace_back(str, start, stop - start);
+    start = stop + 1;
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------
+namespace {
+  /// classes of characters for tokenize: 0 for ordinary characters,
+  /// which are copied in runs, 1 for whitespace, 2 for quotes and
+  /// backslashes
+  struct TokenCharClasses {
+    unsigned char cls[256];
+    constexpr TokenCharClasses() : cls() {
+      cls[static_cast<unsigned char>(' ')]  = 1;
+      cls[static_cast<unsigned char>('\t')] = 1;
+      cls[static_cast<unsigned char>('\n')] = 1;
+      cls[static_cast<unsigned char>('\v')] = 1;
+      cls[static_cast<unsigned char>('\f')] = 1;
+      cls[static_cast<unsigned char>('\r')] = 1;
+      cls[static_cast<unsigned char>('\'')] = 2;
+      cls[static_cast<unsigned char>('"')]  = 2;
+      cls[static_cast<unsigned char>('\\')] = 2;
+    }
+    unsigned char operator()(char c) const {return cls[static_cast<unsigned char>(c)];}
+  };
+  constexpr TokenCharClasses token_char_class;
+}
+
+bool CmdLine::__tokenize(const string & str, Tokens & tokens, size_t & error_position) {
+  // the tokens are never longer in total than str, so the buffer can
+  // be sized once and written through a pointer
+  tokens._tokens.clear();
+  tokens._buffer.assign(str.size(), '\0');
+  char * out = &tokens._buffer[0];
+  size_t nout = 0;
+  const char * p = str.data(), * end = str.data() + str.size();
+  auto copy = [&](const char * from, const char * to) {
+    memcpy(out + nout, from, size_t(to - from));
+    nout += size_t(to - from);
+  };
+
+  while (true) {
+    while (p < end && token_char_class(*p) == 1) p++;
+    if (p == end) break;
+    size_t start = nout;
+    while (p < end) {
+      // a run of ordinary characters
+      const char * run = p;
+      while (p < end && token_char_class(*p) == 0) p++;
+      copy(run, p);
+      if (p == end || token_char_class(*p) == 1) break;
+
+      const char * quote = p++;
+      if (*quote == '\\') {
+        // escaped character (or line continuation, or trailing backslash)
+        if      (p == end)   out[nout++] = '\\';
+        else if (*p == '\n') p++;
+        else                 out[nout++] = *p++;
+      } else if (*quote == '\'') {
+        // everything up to the closing quote is literal
+        const char * close = static_cast<const char *>(memchr(p, '\'', size_t(end - p)));
+        if (!close) {error_position = size_t(quote - str.data()); return false;}
+        copy(p, close);
+        p = close + 1;
+      } else {
+        // double quotes, in which a backslash escapes only " \ $ and `
+        while (true) {
+          run = p;
+          while (p < end && *p != '"' && *p != '\\') p++;
+          copy(run, p);
+          if (p == end) {error_position = size_t(quote - str.data()); return false;}
+          if (*p++ == '"') break;
+          if (p < end && (*p == '"' || *p == '\\' || *p == '$' || *p == '`')) out[nout++] = *p++;
+          else if (p < end && *p == '\n') p++;
+          else out[nout++] = '\\';
+        }
+      }
+    }
+    tokens._tokens.emplace_back(start, nout - start);
+  }
+  tokens._buffer.resize(nout);
+  return true;
+}
+
+CmdLine::Tokens CmdLine::tokenize(const string & str) {
+  Tokens tokens;
+  size_t error_position;
+  if (!__tokenize(str, tokens, error_position)) {
+    throw Error("unterminated quote at character " + to_string(error_position) + " of \"" + str + "\"");
+  }
+  return tokens;
+}
+
+vector<string> CmdLine::Tokens::strings() const {
+  vector<string> result;
+  result.reserve(_tokens.size());
+  for (const auto & token: _tokens) result.emplace_back(_buffer, token.first, token.second);
+  return result;
+}
+
+//----------------------------------------------------------------------
+CmdLine::Sweep::Sweep(const std::vector<std::string> & args, bool zip) : _args(args), _zip(zip) {
+  for (size_t iarg = 1; iarg < _args.size(); iarg++) {
+    Dimension dim;
+    if (!_parse(_args[iarg], dim)) continue;
+    dim.iarg = iarg;
+    _dims.push_back(dim);
+  }
+
+  _size = 1;
+  if (_zip && _dims.size() != 0) {
+    _size = _dims[0].n;
+    for (const auto & dim: _dims) {
+      if (dim.n != _size) {
+        throw Error("zipped sweep arguments must all have the same number of values, but "
+                    + _args[_dims[0].iarg] + " has " + to_string(_size) + " and "
+                    + _args[dim.iarg] + " has " + to_string(dim.n));
+      }
+    }
+  } else {
+    for (const auto & dim: _dims) {
+      if (_size > numeric_limits<uint64_t>::max() / dim.n) {
+        throw Error("the number of points in the sweep is too large to be represented");
+      }
+      _size *= dim.n;
+    }
+  }
+}
+
+std::vector<std::string> CmdLine::Sweep::arguments(uint64_t ipoint) const {
+  if (ipoint >= _size) {
+    throw Error("sweep point " + to_string(ipoint) + " requested, but the sweep has only " 
+                + to_string(_size) + " points");
+  }
+  vector<string> result = _args;
+  // the last dimension varies fastest
+  for (int idim = int(_dims.size())-1; idim >= 0; idim--) {
+    const Dimension & dim = _dims[idim];
+    if (_zip) {
+      result[dim.iarg] = dim.value(ipoint);
+    } else {
+      result[dim.iarg] = dim.value(ipoint % dim.n);
+      ipoint /= dim.n;
+    }
+  }
+  return result;
+}
+
+std::string CmdLine::Sweep::value(unsigned idim, uint64_t ipoint) const {
+  if (idim >= _dims.size()) throw Error("sweep dimension " + to_string(idim) + " does not exist");
+  if (ipoint >= _size) {
+    throw Error("sweep point " + to_string(ipoint) + " requested, but the sweep has only " 
+                + to_string(_size) + " points");
+  }
+  if (_zip) return _dims[idim].value(ipoint);
+  for (unsigned jdim = _dims.size()-1; jdim > idim; jdim--) ipoint /= _dims[jdim].n;
+  return _dims[idim].value(ipoint % _dims[idim].n);
+}
+
+bool CmdLine::Sweep::is_sweep(const std::string & arg) {
+  Dimension dim;
+  return _parse(arg, dim);
+}
+
+std::string CmdLine::Sweep::Dimension::value(uint64_t i) const {
+  if (values.size() != 0) return values[i];
+  if (is_integer) return to_string(istart + (long long)(i) * istep);
+  // use 15 digits, so that rounding in start + i*step does not show
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.15g", dstart + double(i) * dstep);
+  return buffer;
+}
+
+/// returns true if arg is a sweep, in which case dim is set up accordingly
+bool CmdLine::Sweep::_parse(const std::string & arg, Dimension & dim) {
+  // explicit lists, {a,b,c}
+  if (arg.size() >= 2 && arg.front() == '{' && arg.back() == '}') {
+    size_t start = 1;
+    while (true) {
+      size_t end = arg.find(',', start);
+      if (end == string::npos) end = arg.size()-1;
+      dim.values.push_back(arg.substr(start, end-start));
+      if (end == arg.size()-1) break;
+      start = end+1;
+    }
+    dim.n = dim.values.size();
+    return true;
+  }
+
+  // numerical ranges, start:stop:step
+  size_t colon1 = arg.find(':');
+  if (colon1 == string::npos) return false;
+  size_t colon2 = arg.find(':', colon1+1);
+  if (colon2 == string::npos || arg.find(':', colon2+1) != string::npos) return false;
+  string fields[3] = {arg.substr(0, colon1), arg.substr(colon1+1, colon2-colon1-1), arg.substr(colon2+1)};
+
+  bool all_integer = true;
+  double dvals[3];
+  for (int i = 0; i < 3; i++) {
+    const string & field = fields[i];
+    if (field.size() == 0) return false;
+    char * end;
+    dvals[i] = strtod(field.c_str(), &end);
+    if (*end != '\0') return false;
+    if (field.find_first_not_of("+-0123456789") != string::npos) all_integer = false;
+  }
+
+  if (all_integer) {
+    long long ivals[3];
+    for (int i = 0; i < 3; i++) {
+      errno = 0;
+      ivals[i] = strtoll(fields[i].c_str(), nullptr, 10);
+      if (errno == ERANGE) throw Error("sweep range " + arg + " has a value (" + fields[i] 
+                                       + ") that is too large for an integer");
+    }
+    if (ivals[2] == 0) throw Error("sweep range " + arg + " has a zero step");
+    // stop - start, which must not overflow
+    if ((ivals[0] < 0 && ivals[1] > numeric_limits<long long>::max() + ivals[0])
+        || (ivals[0] > 0 && ivals[1] < numeric_limits<long long>::min() + ivals[0])
+        || (ivals[1] - ivals[0] == numeric_limits<long long>::min() && ivals[2] == -1)) {
+      throw Error("sweep range " + arg + " spans too many values");
+    }
+    dim.is_integer = true;
+    dim.istart = ivals[0];
+    dim.istep  = ivals[2];
+    long long nsteps = (ivals[1] - ivals[0]) / ivals[2];
+    if (nsteps < 0) throw Error("sweep range " + arg + " contains no values");
+    dim.n = uint64_t(nsteps) + 1;
+  } else {
+    if (dvals[2] == 0) throw Error("sweep range " + arg + " has a zero step");
+    dim.dstart = dvals[0];
+    dim.dstep  = dvals[2];
+    // allow for a little rounding error in deciding whether stop is reached
+    double nsteps = floor((dvals[1] - dvals[0]) / dvals[2] + 1e-9);
+    if (nsteps < 0) throw Error("sweep range " + arg + " contains no values");
+    // (this also rejects infinities and NaNs)
+    if (!(nsteps < 18446744073709551615.0)) throw Error("sweep range " + arg + " spans too many values");
+    dim.n = uint64_t(nsteps) + 1;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------
+CmdLine::MappedFile::MappedFile(const std::string & filename) : _filename(filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) throw Error("could not open file " + filename);
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+    _size = size_t(info.st_size);
+    if (_size != 0) {
+      void * addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        _mapped = addr;
+        _data = static_cast<const char *>(addr);
+      }
+    }
+  }
+  close(fd);
+  if (_mapped == nullptr) {
+    // fall back to reading the content (this also covers special files
+    // for which the size is reported as zero)
+    ifstream file_in(filename.c_str(), ios::binary);
+    if (!file_in.good()) throw Error("could not read file " + filename);
+    _buffer.assign(istreambuf_iterator<char>(file_in), istreambuf_iterator<char>());
+    _data = _buffer.data();
+    _size = _buffer.size();
+  }
+}
+
+CmdLine::MappedFile::~MappedFile() {
+  if (_mapped != nullptr) munmap(_mapped, _size);
+}
+
+uint64_t CmdLine::MappedFile::hash() const {
+  std::call_once(_hash_flag, [this]() {_hash = __fnv1a_64(_data, _size);});
+  return _hash;
+}
+
+std::shared_ptr<const CmdLine::MappedFile> CmdLine::__mapped_file(const std::string & filename) {
+  return std::static_pointer_cast<const MappedFile>(
+           __shared_object("file:" + __canonical_path(filename), [&]() {
+             return std::shared_ptr<const void>(std::make_shared<MappedFile>(filename));
+           }));
+}
+
+std::shared_ptr<const void> CmdLine::__shared_object(const std::string & key,
+                                   const std::function<std::shared_ptr<const void>()> & create) {
+  // recursive, since create() may itself obtain shared objects (e.g. mapped files)
+  static std::recursive_mutex registry_mutex;
+  static std::map<std::string, std::weak_ptr<const void>> registry;
+  static size_t next_sweep_size = 16;
+  std::lock_guard<std::recursive_mutex> lock(registry_mutex);
+  auto found = registry.find(key);
+  if (found != registry.end()) {
+    std::shared_ptr<const void> result = found->second.lock();
+    if (result) return result;
+  }
+  std::shared_ptr<const void> result = create();
+  // the entries of objects that no longer exist are dropped whenever the
+  // registry has doubled since the last sweep, so that a long-running
+  // program that reads many different files does not accumulate them
+  // (the entry is looked up again, since create() may itself have swept)
+  if (registry.size() >= next_sweep_size) {
+    for (auto it = registry.begin(); it != registry.end(); ) {
+      if (it->second.expired()) it = registry.erase(it);
+      else ++it;
+    }
+    next_sweep_size = std::max(size_t(16), 2 * registry.size());
   }
+  registry[key] = result;
   return result;
 }
 
-// all the terminal control strings
-
-std::string CmdLine::tc::red = "\033[31m";
-std::string CmdLine::tc::grn = "\033[32m";
-std::string CmdLine::tc::yel = "\033[33m";
-std::string CmdLine::tc::blu = "\033[34m";
-std::string CmdLine::tc::mag = "\033[35m";
-std::string CmdLine::tc::cyn = "\033[36m";
-std::string CmdLine::tc::wht = "\033[37m";
-std::string CmdLine::tc::blk = "\033[30m";
-std::string CmdLine::tc::gry = "\033[90m";
-std::string CmdLine::tc::org = "\033[91m";
-
-std::string CmdLine::tc::red_bg = "\033[41m";
-std::string CmdLine::tc::grn_bg = "\033[42m";
-std::string CmdLine::tc::yel_bg = "\033[43m";
-std::string CmdLine::tc::blu_bg = "\033[44m";
-std::string CmdLine::tc::mag_bg = "\033[45m";
-std::string CmdLine::tc::cyn_bg = "\033[46m";
-std::string CmdLine::tc::wht_bg = "\033[47m";
-std::string CmdLine::tc::blk_bg = "\033[40m";
-std::string CmdLine::tc::gry_bg = "\033[100m";
-std::string CmdLine::tc::org_bg = "\033[101m";
-
-// versions with full names for those colors that have >3 letters
-// both foreground and background
-std::string CmdLine::tc::yellow  = "\033[33m";
-std::string CmdLine::tc::blue    = "\033[34m";
-std::string CmdLine::tc::magenta = "\033[35m";
-std::string CmdLine::tc::cyan    = "\033[36m";
-std::string CmdLine::tc::white   = "\033[37m";
-std::string CmdLine::tc::black   = "\033[30m";
-std::string CmdLine::tc::gray    = "\033[90m";
-std::string CmdLine::tc::grey    = "\033[90m";
-std::string CmdLine::tc::orange  = "\033[91m";
-
-std::string CmdLine::tc::yellow_bg  = "\033[43m";
-std::string CmdLine::tc::blue_bg    = "\033[44m";
-std::string CmdLine::tc::magenta_bg = "\033[45m";
-std::string CmdLine::tc::cyan_bg    = "\033[46m";
-std::string CmdLine::tc::white_bg   = "\033[47m";
-std::string CmdLine::tc::black_bg   = "\033[40m";
-std::string CmdLine::tc::gray_bg    = "\033[100m";
-std::string CmdLine::tc::grey_bg    = "\033[100m";
-std::string CmdLine::tc::orange_bg  = "\033[101m";
-
-
-std::string CmdLine::tc::bold = "\033[1m";
-std::string CmdLine::tc::nobold = "\033[22m";
-std::string CmdLine::tc::italics = "\033[3m";
-
-std::string CmdLine::tc::underline = "\033[4m";
-std::string CmdLine::tc::reverse = "\033[7m";
-std::string CmdLine::tc::reset = "\033[0m";
-std::string CmdLine::tc::clear = "\033[2J\033[H"; ///< clear screen and move cursor to home
-std::string CmdLine::tc::clear_screen = "\033[2J";
-std::string CmdLine::tc::clear_line = "\033[2K\r";
+std::string CmdLine::__canonical_path(const std::string & filename) {
+  char * path = realpath(filename.c_str(), nullptr);
+  if (path == nullptr) return filename;
+  string result(path);
+  free(path);
+  return result;
+}
+
+bool CmdLine::__is_binary_filename(const std::string & filename) {
+  for (const string extension: {".bin", ".raw"}) {
+    if (filename.size() > extension.size() 
+        && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0) return true;
+  }
+  return false;
+}
+
+uint64_t CmdLine::__fnv1a_64(const char * data, size_t n) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; i++) {
+    hash ^= uint64_t(static_cast<unsigned char>(data[i]));
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/// the state shared between copies of a ListFile
+struct CmdLine::ListFile::Data {
+  std::string reference;
+  std::shared_ptr<const MappedFile> file;
+  // the number of entries, which is computed on first use
+  std::once_flag size_flag;
+  size_t size = 0;
+};
+
+CmdLine::ListFile::ListFile(const std::string & value) : _data(std::make_shared<Data>()) {
+  _data->reference = value;
+  if (value.size() > 1 && value[0] == '@') {
+    _data->file = __mapped_file(value.substr(1));
+    _begin = _data->file->data();
+    _end   = _begin + _data->file->size();
+  } else {
+    _begin = _data->reference.data();
+    _end   = _begin + _data->reference.size();
+  }
+}
+
+void CmdLine::ListFile::iterator::_find_entry() {
+  while (_pos != _end) {
+    const char * newline = static_cast<const char *>(memchr(_pos, '\n', size_t(_end - _pos)));
+    _next      = newline == nullptr ? _end : newline + 1;
+    _entry_end = newline == nullptr ? _end : newline;
+    if (_entry_end != _pos && _entry_end[-1] == '\r') --_entry_end;
+    // skip blank lines and comments
+    if (_entry_end != _pos && *_pos != '#') return;
+    _pos = _next;
+  }
+  _entry_end = _next = _end;
+}
+
+size_t CmdLine::ListFile::size() const {
+  if (!_data) return 0;
+  std::call_once(_data->size_flag, [this]() {_data->size = size_t(std::distance(begin(), end()));});
+  return _data->size;
+}
+
+const std::string & CmdLine::ListFile::reference() const {
+  static const std::string empty;
+  return _data ? _data->reference : empty;
+}
+
+bool CmdLine::ListFile::from_file() const {return _data && _data->file;}
+
+uint64_t CmdLine::ListFile::hash() const {
+  if (from_file()) return _data->file->hash();
+  return __fnv1a_64(_begin, size_t(_end - _begin));
+}
+
+template<> CmdLine::ListFile CmdLine_string_to_value<CmdLine::ListFile>(const std::string & str) {
+  return CmdLine::ListFile(str);
+}
+
+template<> std::string CmdLine_value_to_string<CmdLine::ListFile>(const CmdLine::ListFile & list) {
+  return list.reference();
+}
+
+template<> std::string CmdLine_value_annotation<CmdLine::ListFile>(const CmdLine::ListFile & list) {
+  if (!list.from_file()) return "";
+  char hash[17];
+  snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(list.hash()));
+  return std::to_string(list.size()) + " entries, fnv1a64 " + hash;
+}
+
+// all the terminal control codes
+//
+// before C++17, constexpr static members that are odr-used (e.g. bound to
+// the const reference in operator<<) need a definition at namespace scope
+#if __cplusplus < 201703L
+constexpr CmdLine::tc::code CmdLine::tc::red;
+constexpr CmdLine::tc::code CmdLine::tc::grn;
+constexpr CmdLine::tc::code CmdLine::tc::yel;
+constexpr CmdLine::tc::code CmdLine::tc::blu;
+constexpr CmdLine::tc::code CmdLine::tc::mag;
+constexpr CmdLine::tc::code CmdLine::tc::cyn;
+constexpr CmdLine::tc::code CmdLine::tc::wht;
+constexpr CmdLine::tc::code CmdLine::tc::blk;
+constexpr CmdLine::tc::code CmdLine::tc::gry;
+constexpr CmdLine::tc::code CmdLine::tc::org;
+constexpr CmdLine::tc::code CmdLine::tc::red_bg;
+constexpr CmdLine::tc::code CmdLine::tc::grn_bg;
+constexpr CmdLine::tc::code CmdLine::tc::yel_bg;
+constexpr CmdLine::tc::code CmdLine::tc::blu_bg;
+constexpr CmdLine::tc::code CmdLine::tc::mag_bg;
+constexpr CmdLine::tc::code CmdLine::tc::cyn_bg;
+constexpr CmdLine::tc::code CmdLine::tc::wht_bg;
+constexpr CmdLine::tc::code CmdLine::tc::blk_bg;
+constexpr CmdLine::tc::code CmdLine::tc::gry_bg;
+constexpr CmdLine::tc::code CmdLine::tc::org_bg;
+constexpr CmdLine::tc::code CmdLine::tc::yellow;
+constexpr CmdLine::tc::code CmdLine::tc::blue;
+constexpr CmdLine::tc::code CmdLine::tc::magenta;
+constexpr CmdLine::tc::code CmdLine::tc::cyan;
+constexpr CmdLine::tc::code CmdLine::tc::white;
+constexpr CmdLine::tc::code CmdLine::tc::black;
+constexpr CmdLine::tc::code CmdLine::tc::gray;
+constexpr CmdLine::tc::code CmdLine::tc::grey;
+constexpr CmdLine::tc::code CmdLine::tc::orange;
+constexpr CmdLine::tc::code CmdLine::tc::yellow_bg;
+constexpr CmdLine::tc::code CmdLine::tc::blue_bg;
+constexpr CmdLine::tc::code CmdLine::tc::magenta_bg;
+constexpr CmdLine::tc::code CmdLine::tc::cyan_bg;
+constexpr CmdLine::tc::code CmdLine::tc::white_bg;
+constexpr CmdLine::tc::code CmdLine::tc::black_bg;
+constexpr CmdLine::tc::code CmdLine::tc::gray_bg;
+constexpr CmdLine::tc::code CmdLine::tc::grey_bg;
+constexpr CmdLine::tc::code CmdLine::tc::orange_bg;
+constexpr CmdLine::tc::code CmdLine::tc::bold;
+constexpr CmdLine::tc::code CmdLine::tc::nobold;
+constexpr CmdLine::tc::code CmdLine::tc::italics;
+constexpr CmdLine::tc::code CmdLine::tc::underline;
+constexpr CmdLine::tc::code CmdLine::tc::reverse;
+constexpr CmdLine::tc::code CmdLine::tc::reset;
+constexpr CmdLine::tc::code CmdLine::tc::clear;
+constexpr CmdLine::tc::code CmdLine::tc::clear_screen;
+constexpr CmdLine::tc::code CmdLine::tc::clear_line;
+#endif
+
+namespace {
+  /// the mode set by the user (constant initialised, so that it can be
+  /// set before or during static initialisation elsewhere)
+  std::atomic<int> tc_mode{CmdLine::tc::automatic};
+
+  /// bit 0 (1): colour allowed for stdout; bit 1 (2): colour allowed for
+  /// stderr; determined once per process
+  int tc_automatic() {
+    static const int result = [](){
+      const char * no_color = getenv("NO_COLOR");
+      if (no_color != nullptr && no_color[0] != '\0') return 0;
+      const char * term = getenv("TERM");
+      if (term != nullptr && strcmp(term, "dumb") == 0) return 0;
+      return (isatty(STDOUT_FILENO) ? 1 : 0) | (isatty(STDERR_FILENO) ? 2 : 0);
+    }();
+    return result;
+  }
+
+  /// whether colour is enabled for the output with the given bit
+  /// (0 for streams that are not associated with a terminal)
+  bool tc_enabled(int bit) {
+    switch (tc_mode.load(std::memory_order_relaxed)) {
+    case CmdLine::tc::always: return true;
+    case CmdLine::tc::never:  return false;
+    default:                  return (tc_automatic() & bit) != 0;
+    }
+  }
+}
+
+const char * CmdLine::TerminalCode::c_str() const {return tc::enabled() ? _sequence : "";}
+
+void CmdLine::tc::set_mode(mode m) {tc_mode.store(m, std::memory_order_relaxed);}
+bool CmdLine::tc::enabled() {return tc_enabled(1);}
+bool CmdLine::tc::enabled(const std::ostream & ostr) {
+  if (&ostr == &cout) return tc_enabled(1);
+  if (&ostr == &cerr || &ostr == &clog) return tc_enabled(2);
+  return tc_enabled(0);
+}
+
+std::ostream & operator<<(std::ostream & ostr, const CmdLine::tc::code & code) {
+  if (CmdLine::tc::enabled(ostr)) ostr << code.sequence();
+  return ostr;
+}
+std::string operator+(const CmdLine::tc::code & code, const std::string & str) {return code.c_str() + str;}
+std::string operator+(const std::string & str, const CmdLine::tc::code & code) {return str + code.c_str();}
+std::string operator+(const CmdLine::tc::code & code, const char * str) {return std::string(code.c_str()) + str;}
+std::string operator+(const char * str, const CmdLine::tc::code & code) {return str + std::string(code.c_str());}
+std::string operator+(const CmdLine::tc::code & code1, const CmdLine::tc::code & code2) {
+  return std::string(code1.c_str()) + code2.c_str();
+}
+
+//----------------------------------------------------------------------
+// explicit instantiations of the conversions that are not specialised
+// for the common types (the option-value templates themselves are
+// instantiated in CmdLine-instantiations.cc, cf. CMDLINE_INSTANTIATIONS)
+template int      CmdLine_string_to_value<int>     (const std::string &);
+template unsigned CmdLine_string_to_value<unsigned>(const std::string &);
+template int64_t  CmdLine_string_to_value<int64_t> (const std::string &);
+template uint64_t CmdLine_string_to_value<uint64_t>(const std::string &);
+template double   CmdLine_string_to_value<double>  (const std::string &);
+template float    CmdLine_string_to_value<float>   (const std::string &);
+template std::string CmdLine_value_to_string<bool>(const bool &);
@@ -26,18 +26,71 @@
 #define __CMDLINE__
 
 #include<string>
-#include<sstream>
-#include<iostream>
+#include<iosfwd>
 #if __cplusplus >= 201703L
 #include<optional>
+#include<string_view>
+#endif
+#if __cplusplus >= 202002L
+#include<span>
 #endif
 
 #include<map>
 #include<vector>
 #include<ctime>
+#include<cstdint>
 #include<memory>
+#include<type_traits>
 #include<typeinfo> 
 #include<functional>
+#include<iterator>
+#include<initializer_list>
+
+template<class T> T CmdLine_string_to_value(const std::string & str);
+template<class T> bool CmdLine_try_string_to_value(const std::string & str, T & value);
+template<class T> std::string CmdLine_value_to_string(const T & value);
+template<class T> std::string CmdLine_value_to_string(const std::vector<T> & values);
+template<class T> std::vector<std::string> CmdLine_values_to_strings(const T & value);
+template<class T> std::vector<std::string> CmdLine_values_to_strings(const std::vector<T> & values);
+template<class T> std::string CmdLine_value_annotation(const T & value);
+
+/// the names of all valid values of type T, listed as the choices of
+/// options of that type (none by default; CmdLineEnum.hh specialises it
+/// for enums declared with CMDLINE_ENUM)
+template<class T, class Enable = void> struct CmdLine_value_names {
+  static std::vector<std::string> names() {return {};}
+};
+
+/// the type of the value of CmdLine::value_or_else<T>(opt, default_fn):
+/// T, or if T is omitted, the type returned by default_fn()
+template<class T, class F> struct CmdLine_or_else_type {typedef T type;};
+template<class F> struct CmdLine_or_else_type<void, F> {
+  typedef typename std::decay<decltype(std::declval<F &>()())>::type type;
+};
+
+/// storage of the value held by a CmdLine::Result<T>: small trivially
+/// copyable values are held directly, while others are allocated once and
+/// shared by all copies of the Result (including the one kept for
+/// reuse_value and dump), so that copying a Result never copies the value
+template<class T, bool held_directly = std::is_trivially_copyable<T>::value
+                                       && sizeof(T) <= 2 * sizeof(void *)>
+class CmdLine_result_storage {
+public:
+  CmdLine_result_storage() : _value(std::make_shared<const T>()) {}
+  CmdLine_result_storage(const T & value) : _value(std::make_shared<const T>(value)) {}
+  CmdLine_result_storage(T && value) : _value(std::make_shared<const T>(std::move(value))) {}
+  const T & get() const {return *_value;}
+private:
+  std::shared_ptr<const T> _value;
+};
+template<class T> class CmdLine_result_storage<T, true> {
+public:
+  CmdLine_result_storage() : _value() {}
+  CmdLine_result_storage(const T & value) : _value(value) {}
+  const T & get() const {return _value;}
+private:
+  T _value;
+};
 
 /// Class designed to deal with command-line arguments.
 ///
@@ -77,9 +130,95 @@ class CmdLine {
     required_value,      ///< value<T>("-opt")
     value_with_default,  ///< value<T>("-opt", defval)
     optional_value,      ///< optional_value<T>("-opt")
+    all_values,          ///< value_all<T>("-opt")
+    positional,          ///< positional<T>("name")
     undefined            ///< undefined
   };
 
+  class ParseError;
+  template<class T> class Expected;
+
+  /// @brief the name of an option, referring to characters stored
+  /// elsewhere (in a std::string, a string literal or, with C++17, the
+  /// target of a std::string_view), so that it can be looked up without
+  /// being copied into a std::string
+  class OptionName {
+  public:
+    OptionName() : _data(""), _size(0) {}
+    OptionName(const std::string & name) : _data(name.data()), _size(name.size()) {}
+    OptionName(const char * name) : _data(name), _size(std::char_traits<char>::length(name)) {}
+    OptionName(const char * name, size_t size) : _data(name), _size(size) {}
+#if __cplusplus >= 201703L
+    OptionName(std::string_view name) : _data(name.data()), _size(name.size()) {}
+    operator std::string_view() const {return std::string_view(_data, _size);}
+#endif
+    const char * data() const {return _data;}
+    size_t size() const {return _size;}
+    std::string str() const {return std::string(_data, _size);}
+
+    // comparisons with std::string, for lookups in maps with std::less<>
+    friend bool operator<(const std::string & a, const OptionName & b) {
+      return a.compare(0, a.size(), b._data, b._size) < 0;}
+    friend bool operator<(const OptionName & a, const std::string & b) {
+      return b.compare(0, b.size(), a._data, a._size) > 0;}
+    friend bool operator==(const std::string & a, const OptionName & b) {
+      return a.compare(0, a.size(), b._data, b._size) == 0;}
+  private:
+    const char * _data;
+    size_t _size;
+  };
+
+  /// @brief the names of an option and its aliases, e.g. {"-o","--output"}
+  ///
+  /// This refers to the names without copying them, whether they are
+  /// given as a single name, an initializer list, a std::vector or a
+  /// static array, e.g.
+  ///
+  ///     static const char * const output_opts[] = {"-o", "--output"};
+  ///     auto output = cmdline.value<std::string>(output_opts);
+  ///
+  /// so that queries with literal names need no memory allocation. It
+  /// should only be used as a function argument, since it does not keep
+  /// the names alive.
+  class OptionNames {
+  public:
+    OptionNames(const std::string & name) : _single(name), _size(1) {}
+    OptionNames(const char * name) : _single(name), _size(1) {}
+    OptionNames(OptionName name) : _single(name), _size(1) {}
+#if __cplusplus >= 201703L
+    OptionNames(std::string_view name) : _single(name), _size(1) {}
+#endif
+    OptionNames(const std::vector<std::string> & names) : _strings(names.data()), _size(names.size()) {}
+    // the array of an initializer list given as a function argument lives
+    // until the end of the full expression containing the call
+    OptionNames(std::initializer_list<std::string> names) : _strings(std::begin(names)), _size(names.size()) {}
+    OptionNames(std::initializer_list<const char *> names) : _c_strings(std::begin(names)), _size(names.size()) {}
+    template<size_t N> OptionNames(const std::string (&names)[N]) : _strings(names), _size(N) {}
+    template<size_t N> OptionNames(const char * const (&names)[N]) : _c_strings(names), _size(N) {}
+    OptionNames(const OptionName * names, size_t size) : _names(names), _size(size) {}
+
+    size_t size() const {return _size;}
+    OptionName operator[](size_t i) const {
+      if (_strings)   return _strings[i];
+      if (_c_strings) return _c_strings[i];
+      if (_names)     return _names[i];
+      return _single;
+    }
+    /// copies of the names
+    std::vector<std::string> strings() const {
+      std::vector<std::string> result;
+      result.reserve(_size);
+      for (size_t i = 0; i < _size; i++) result.push_back((*this)[i].str());
+      return result;
+    }
+  private:
+    OptionName _single;
+    const std::string  * _strings   = nullptr;
+    const char * const * _c_strings = nullptr;
+    const OptionName   * _names     = nullptr;
+    size_t _size;
+  };
+
   /// base class for holding results
   class ResultBase {
   public:
@@ -87,8 +226,23 @@ class CmdLine {
     virtual bool present() const = 0;
     virtual bool has_value() const = 0;
     virtual std::string value_as_string() const = 0;
+    /// returns the value(s) as a vector of strings, which has more than
+    /// one entry only for options that collect several values
+    virtual std::vector<std::string> values_as_strings() const {return {value_as_string()};}
+    /// returns a note about the value that is not part of the value itself
+    /// (e.g. a hash of the content of a file that it refers to), or an
+    /// empty string if there is nothing to note
+    virtual std::string value_annotation() const {return "";}
   };
 
+  /// base class for the validation data of an option (its choices and
+  /// range), built once per option and kept with its OptionHelp
+  class ValidatorBase {
+  public:
+    virtual ~ValidatorBase() {}
+  };
+  template<class T> class Validator;
+
   /// class to store help related to an option
   class OptionHelp {
   public:
@@ -99,15 +253,29 @@ class CmdLine {
     std::vector<std::string> choices;
     std::vector<std::string> choices_help;
     std::vector<std::string> range_strings;
+    /// true if the choices come from CmdLine_value_names<T> rather than
+    /// from Result::choices(...), which then replaces them
+    bool automatic_choices = false;
     bool required;
     bool takes_value;
     bool has_default;
     bool no_dump = false;
+    /// true for value_bool options, whose value may be omitted (-opt
+    /// alone means true) and which can be negated with -no-opt
+    bool value_is_optional = false;
     OptKind kind;
+    /// for positional arguments, the allowed number of values
+    unsigned min_count = 0, max_count = 0;
 
     std::shared_ptr<ResultBase> result_ptr;
+    /// the choices and range in their native type, set by the first
+    /// Result::choices(...) or range(...), which later calls reuse
+    std::shared_ptr<ValidatorBase> validator;
 
     std::string section, subsection;
+    /// the prefix of the CmdLine::Scope through which the option was
+    /// queried (empty if none); help and dump() group options by scope
+    std::string scope;
     /// returns a short summary of the option (suitable for
     /// placing in the command-line summary
     std::string summary() const; 
@@ -134,27 +302,42 @@ class CmdLine {
   template<class T>
   class Result : public ResultBase {
   public:
-    Result() : _opthelp(nullptr), _is_present(false) {}
-    Result(const T & t) : _t(t), _opthelp(0), _is_present(true) {}
-    Result(const T & t, OptionHelp * opthelp_ptr, bool is_present) : 
-               _t(t), _opthelp(opthelp_ptr), _is_present(is_present) {}
+    Result() : _opthelp(nullptr), _is_present(false), _kind(OptKind::undefined) {}
+    Result(const T & t) : _t(t), _opthelp(0), _is_present(true), _kind(OptKind::undefined) {}
+    Result(T && t) : _t(std::move(t)), _opthelp(0), _is_present(true), _kind(OptKind::undefined) {}
+    /// the kind is recorded in the result itself, so that it is
+    /// known even when help is disabled and opthelp_ptr is null;
+    /// is_placeholder marks a value that stands in for a default that
+    /// was not computed (e.g. value_or_else with help requested)
+    Result(const T & t, OptionHelp * opthelp_ptr, bool is_present, OptKind kind = OptKind::undefined,
+           bool is_placeholder = false) : 
+               _t(t), _opthelp(opthelp_ptr), _is_present(is_present), _kind(kind), 
+               _is_placeholder(is_placeholder) {}
+    Result(T && t, OptionHelp * opthelp_ptr, bool is_present, OptKind kind = OptKind::undefined,
+           bool is_placeholder = false) : 
+               _t(std::move(t)), _opthelp(opthelp_ptr), _is_present(is_present), _kind(kind), 
+               _is_placeholder(is_placeholder) {}
 
     /// this allows for implicit conversion to type T in assignments
     operator T() const;
 
-    /// this allows the user to do the conversion to the argument's value manually
-    T operator()() const;
+    /// this allows the user to do the conversion to the argument's value
+    /// manually; it returns a reference to the value, which is shared by
+    /// all copies of the Result (or a copy, for a temporary Result)
+    const T & operator()() const &;
+    T operator()() const &&;
 
 #if __cplusplus >= 201703L
     /// conversion to std::optional<T> (C++17 and later)
     std::optional<T> std_optional() const {
-      if (has_value()) return std::optional<T>(_t);
+      if (has_value()) return std::optional<T>(_t.get());
       else return std::nullopt;
     }
 #endif
 
     /// an alternative member name for getting the value manually
-    T value() const;
+    const T & value() const &;
+    T value() const &&;
 
     /// returns true if the argument was present on the command-line
     bool present() const override {return _is_present;}
@@ -164,13 +347,24 @@ class CmdLine {
 
     /// returns the value of the option, or val if the option is not present
     T value_or(T val) const {
-      if (has_value()) return _t;
+      if (has_value()) return _t.get();
       else return val;
     }
 
-    /// returns the value of the option, as a string (with 16 digits precision)
+    /// returns the value of the option, as a string (for floating-point
+    /// types, the shortest string that converts back to the same value)
     std::string value_as_string() const override;
 
+    /// returns the value(s) of the option, as a vector of strings
+    std::vector<std::string> values_as_strings() const override {
+      return CmdLine_values_to_strings((*this)());
+    }
+
+    /// returns a note about the value, e.g. a content hash for list files
+    std::string value_annotation() const override {
+      return CmdLine_value_annotation((*this)());
+    }
+
     /// for adding help to an option
     const Result & help(const std::string & help_string) const {
       opthelp().help = help_string;
@@ -207,15 +401,33 @@ class CmdLine {
     void set_opthelp(OptionHelp * opthelp) {_opthelp = opthelp;}
 
     /// returns the OptKind enum indicating what kind of option this is
-    OptKind kind() const {return _opthelp ? _opthelp->kind : OptKind::undefined;}
+    OptKind kind() const {
+      if (_kind != OptKind::undefined) return _kind;
+      return _opthelp ? _opthelp->kind : OptKind::undefined;
+    }
 
 
   protected:
     void throw_value_not_available() const;
+    /// returns the validator in the option's help, creating it if need
+    /// be, or local if help is disabled
+    Validator<T> & _validator(Validator<T> & local) const;
+    /// the name of the option, for error messages
+    std::string _option_name() const;
+    /// true if the value is only a placeholder, which is not checked
+    /// against choices or a range (an absent optional value, or an
+    /// absent required value when help is requested, or a default
+    /// that was not computed)
+    bool _placeholder() const {
+      return _is_placeholder || 
+             (!_is_present && (kind() == OptKind::optional_value || kind() == OptKind::required_value));
+    }
 
-    T _t;
+    CmdLine_result_storage<T> _t;
     mutable OptionHelp * _opthelp;
     bool _is_present;
+    OptKind _kind;
+    bool _is_placeholder = false;
   };
   
   CmdLine() {};
@@ -224,60 +436,190 @@ class CmdLine {
   /// initialise a CmdLine from a C++ std::vector of arguments; the 0th argument should be the command name 
   CmdLine(const std::vector<std::string> & args, bool enable_help = true, const std::string & file_option=_default_argfile_option );
   /// @brief  initialise a CmdLine from a string containing the command
-  /// line; the string will be split at spaces, with multiple spaces
-  /// treated as one; the first item is expected to be the command name
-  CmdLine(const std::string & cmdline_string, bool enable_help = true, const std::string & file_option=_default_argfile_option ) :
-    CmdLine(split_at_spaces(cmdline_string), enable_help, file_option) {}
+  /// line; the string is split into arguments with tokenize(...), i.e.
+  /// at whitespace, with shell-like quotes and backslash escapes; the
+  /// first item is expected to be the command name
+  CmdLine(const std::string & cmdline_string, bool enable_help = true, const std::string & file_option=_default_argfile_option );
+
+  /// @brief like the constructor from a vector of arguments, but
+  /// reports problems with the arguments (a missing command name or
+  /// argfile, an invalid sweep index, etc.) through the returned
+  /// Expected<CmdLine> rather than by throwing a CmdLine::Error.
+  ///
+  /// This is intended for command lines from untrusted sources, where
+  /// invalid input is common. Use it as
+  ///
+  ///     auto parsed = CmdLine::try_parse(str);
+  ///     if (!parsed) {... parsed.error().message() ...}
+  ///     CmdLine & cmdline = parsed.value();
+  ///
+  /// The CmdLine should not be copied out of the Expected (a copy would
+  /// refer to the help records of the original); move it if need be.
+  static Expected<CmdLine> try_parse(const std::vector<std::string> & args, bool enable_help = true,
+                                     const std::string & file_option=_default_argfile_option);
+  /// as try_parse(args,...), for a string split with tokenize (an
+  /// unterminated quote gives a ParseError::bad_quoting)
+  static Expected<CmdLine> try_parse(const std::string & cmdline_string, bool enable_help = true,
+                                     const std::string & file_option=_default_argfile_option);
+
+  /// @brief replaces the arguments with args (whose 0th element is the
+  /// command name), as if the CmdLine had been constructed from them,
+  /// reusing the memory already allocated for the arguments and the
+  /// option index.
+  ///
+  /// The settings (help enabled, argfile option, git info, fussiness)
+  /// and the help records of options queried so far are kept, but the
+  /// results of those queries are discarded, so options should be
+  /// queried again. Reparsing arguments of a similar shape (the same
+  /// options, values no longer than before) needs no memory allocation
+  /// (C++17 and later). Clones made with with_overrides(...) and
+  /// subcommands should not be used after their parent is reset.
+  CmdLine & reset(const std::vector<std::string> & args);
+
+  class Pooled;
+
+  /// @brief returns a CmdLine for args taken from a small thread-local
+  /// pool, which it returns to when the Pooled handle is destroyed.
+  ///
+  /// A CmdLine from the pool is reset(args), and so keeps the help
+  /// records of the options queried by its previous users: the pool is
+  /// intended for repeatedly parsing command lines of the same kind.
+  static Pooled pooled(const std::vector<std::string> & args);
+
+  /// @brief returns a lightweight clone of this CmdLine, in which each
+  /// (option,value) pair in overrides behaves as if it had been appended
+  /// to the command line (an empty value gives an option without a value)
+  ///
+  /// The clone shares the parsed arguments and option index with its
+  /// parent and stores only the overrides, so that the cost of cloning
+  /// is proportional to the number of overrides. Options should then be
+  /// queried on the clone, whose help and dump() cover those queries.
+  CmdLine with_overrides(const std::vector<std::pair<std::string,std::string>> & overrides) const;
 
   /// @name Member functions to add and classify command-line options
   ///@{
 
-  /// return true if the option is present
-  Result<bool> present(const std::string & opt) const {return any_present(std::vector<std::string>{opt});}
-
-  /// returns the value of the argument following opt, converted to type Result<T>
-  template<class T> Result<T> value(const std::string & opt) const {
-    return any_value<T>({opt});}
+  // Options are named with an OptionNames, i.e. a single name
+  // ("-opt", a std::string or a std::string_view) or a list of
+  // (mutually exclusive) aliases: {"-o","--opt"}, a std::vector or
+  // a static array of names.
 
-  /// returns the value of the argument following any of opts, converted to type Result<T>
-  template<class T> Result<T> value(const std::initializer_list<std::string> & opts) const {
-    return any_value<T>(opts);}
+  /// return true if the option is present
+  Result<bool> present(const OptionNames & opts) const {return any_present(opts);}
 
-  /// returns the value of the argument following any of opts, converted to type Result<T>
-  template<class T> Result<T> value(const std::vector<std::string> & opts) const {
+  /// returns the value of the argument following opts, converted to type Result<T>
+  template<class T> Result<T> value(const OptionNames & opts) const {
     return any_value<T>(opts);}
 
-
-  /// returns the value of the option, or defval if the option is not present
-  template<class T> Result<T> value(const std::string & opt, const T & defval) const {
-    return any_value<T>({opt}, defval);
-  }
-  /// returns the value of any of the options (opts), or defval if none of the options is not present
-  template<class T> Result<T> value(const std::initializer_list<std::string> & opts, const T & defval) const {
+  /// returns the value of any of the options (opts), or defval if none of the options is present
+  template<class T> Result<T> value(const OptionNames & opts, const T & defval) const {
     return any_value<T>(opts, defval);
   }
-  /// returns the value of any of the options (opts), or defval if none of the options is not present
-  template<class T> Result<T> value(const std::vector<std::string> & opts, const T & defval) const {
-    return any_value<T>(opts, defval);
+
+  /// @brief returns the value of the option, or default_fn() if the
+  /// option is not present, e.g.
+  ///
+  ///     auto table = cmdline.value_or_else("-table", [&]{return load_table();}, "built-in table");
+  ///
+  /// default_fn is called only if the option is absent, and the type of
+  /// the result is that returned by default_fn, unless given explicitly
+  /// (value_or_else<T>(...)). The help shows default_help as the default;
+  /// if it is empty, default_fn is also called when help is requested, so
+  /// that the help can show the default value.
+  template<class T = void, class F> Result<typename CmdLine_or_else_type<T,F>::type> 
+  value_or_else(const OptionNames & opts, const F & default_fn, const std::string & default_help = "") const {
+    return any_value_or_else<typename CmdLine_or_else_type<T,F>::type>(opts, default_fn, default_help);
   }
 
+  /// like value<T>(opt), but problems (option or value absent, value
+  /// not convertible) are reported through the returned Expected<T>
+  /// rather than by throwing; the message is only formatted if
+  /// requested, with error().message()
+  template<class T> Expected<T> try_value(OptionName opt) const;
+  /// like value<T>(opt, defval), with problems reported as for try_value<T>(opt)
+  template<class T> Expected<T> try_value(OptionName opt, const T & defval) const;
+
+  /// returns the values following every occurrence of any of opts, in
+  /// the order in which they appear on the command line (an empty vector
+  /// if none is present)
+  template<class T> Result<std::vector<T>> value_all(const OptionNames & opts) const {
+    return any_value_all<T>(opts);}
+
+  class ArgView;
+
+  /// value of max_count for positional arguments with no upper limit
+  static constexpr unsigned any_count = ~0u;
+
+  /// @brief returns a view of the positional arguments, i.e. those that
+  /// are neither options nor values of options, together with all
+  /// arguments after a standalone "--"
+  ///
+  /// The view refers to the stored arguments, without copying them. name
+  /// is used in the help and the number of positional arguments must
+  /// lie between min_count and max_count. Options should be queried
+  /// before positional arguments, since those queries determine which
+  /// arguments are option values.
+  Result<ArgView> positional_view(const std::string & name, unsigned min_count = 0, 
+                                  unsigned max_count = any_count) const;
+
+  /// returns the positional arguments (cf. positional_view), converted to type T
+  template<class T> Result<std::vector<T>> positional(const std::string & name, unsigned min_count = 0, 
+                                                      unsigned max_count = any_count) const;
+
+  /// @brief registers a subcommand, as in "git commit ..."
+  ///
+  /// The subcommand is the first argument that is neither an option nor
+  /// the value of an option, with the same rules as for positional
+  /// arguments, so the options of the main program should be queried
+  /// before the subcommands are registered. If that argument is name,
+  /// a nested CmdLine is created from the arguments that follow it and
+  /// passed to registration, which should query the subcommand's
+  /// options. registration is not called for other subcommands, so their
+  /// options are never registered. The nested CmdLine has its own help
+  /// (e.g. "prog fit -h"), its own section in dump() and its own check
+  /// of unused options in assert_all_options_used().
+  ///
+  /// @return true if this subcommand was selected
+  bool subcommand(const std::string & name, const std::string & help,
+                  const std::function<void(CmdLine &)> & registration);
+
+  /// the name of the selected subcommand (empty if none was selected)
+  const std::string & subcommand_name() const {return __subcommand_name;}
+
+  /// the nested CmdLine of the selected subcommand (throws if none was selected)
+  CmdLine & subcommand_cmdline() const;
+
+  class Scope;
+
+  /// @brief returns a view of the options whose names start with prefix,
+  /// e.g. for families of options such as -det1-thr, -det2-thr, etc.,
+  /// 
+  ///     auto det = cmdline.scope("-det" + std::to_string(i));
+  ///     double thr = det.value<double>("-thr", 0.5);  // i.e. -det17-thr
+  ///
+  /// The options are queried on this CmdLine, looking them up among
+  /// those that start with the prefix (cf. Scope), and help and dump()
+  /// list the options of a scope together (within their section).
+  Scope scope(const std::string & prefix) const;
+
+  /// @brief returns the names of the options on the command line that
+  /// match the pattern, in which '*' stands for any sequence of
+  /// characters (e.g. "-det*-thr"), sorted, and each name only once.
+  ///
+  /// The options are found in a single pass over the part of the
+  /// (ordered) option index that starts with the pattern's prefix
+  /// before the first '*'. The options are not marked as used.
+  std::vector<std::string> options_matching(const std::string & pattern) const;
+
   /// returns the previously queried value for opt
   ///
   /// This reuses the value/result from an earlier value-like query and
   /// throws if no matching prior query exists or if the type differs.
-  template<class T> Result<T> reuse_value(const std::string & opt) const;
+  template<class T> Result<T> reuse_value(OptionName opt) const;
 
   /// returns a Result<T> for the option; the result.present() should be queried to
   /// see if it was present before trying to use the value
-  template<class T> Result<T> optional_value(const std::string & opt) const {
-    return any_optional_value<T>({opt});
-  }
-  /// returns a Result<T> for the any of the option(opts); the result.present() should be queried to
-  /// see if it was present before trying to use the value
-  template<class T> Result<T> optional_value(const std::initializer_list<std::string> & opts) const {
-    return any_optional_value<T>(opts);
-  }
-  template<class T> Result<T> optional_value(const std::vector<std::string> & opts) const {
+  template<class T> Result<T> optional_value(const OptionNames & opts) const {
     return any_optional_value<T>(opts);
   }
 
@@ -287,15 +629,15 @@ class CmdLine {
   /// automatically converted from a string to some other type via
   /// the << operator, but the conversion needs a prefix to be
   /// applied to the argument for the conversion to work.
-  template<class T> Result<T> value_prefix(const std::string & opt, const std::string & prefix) const {
-    return any_value_prefix<T>(std::vector<std::string>{opt}, prefix);
+  template<class T> Result<T> value_prefix(const OptionNames & opts, const std::string & prefix) const {
+    return any_value_prefix<T>(opts, prefix);
   }
 
   /// returns the value of the argument, prefixed with prefix, with defval returned
   /// if the option is not present.
-  template<class T> Result<T> value(const std::string & opt, const T & defval, 
+  template<class T> Result<T> value(const OptionNames & opts, const T & defval, 
                                     const std::string & prefix) const {
-    return any_value<T>(std::vector<std::string>{opt}, defval, prefix);
+    return any_value<T>(opts, defval, prefix);
   }
 
   /// If one of the following is present, then return as indicated
@@ -306,41 +648,43 @@ class CmdLine {
   ///   * -opt 0  -> false     [also valid are off, no, false, .false.]
   ///
   /// otherwise return the default
-  Result<bool> value_bool(const std::string & opt, const bool defval) const {
-    return any_value_bool({opt}, defval);
-  }
-  Result<bool> value_bool(const std::vector<std::string> & opts, const bool defval) const {
-    return any_value_bool(opts, defval);
-  }
-  Result<bool> value_bool(const std::initializer_list<std::string> & opts, const bool defval) const {
+  Result<bool> value_bool(const OptionNames & opts, const bool defval) const {
     return any_value_bool(opts, defval);
   }
   
-  Result<bool> any_value_bool(const std::vector<std::string> & opts, const bool defval) const;
+  Result<bool> any_value_bool(const OptionNames & opts, const bool defval) const;
 
 
   /// return true if any of the options in the option vector is present
   /// (at most one of the options should be present)
-  Result<bool> any_present(const std::vector<std::string> & opts) const;
+  Result<bool> any_present(const OptionNames & opts) const;
 
   /// returns the value of the argument following any of the (mutually
   /// exclusive) opts, converted to type Result<T> 
-  template<class T> Result<T> any_value(const std::vector<std::string> & opts) const;
+  template<class T> Result<T> any_value(const OptionNames & opts) const;
 
   /// returns the value following any of the (mutually exclusive)
   /// options, or defval if none is present
-  template<class T> Result<T> any_value(const std::vector<std::string> & opt, const T & defval) const;
+  template<class T> Result<T> any_value(const OptionNames & opts, const T & defval) const;
+
+  /// like value_or_else, for a (mutually exclusive) vector of options
+  template<class T, class F> Result<T> any_value_or_else(const OptionNames & opts, 
+                                                         const F & default_fn, 
+                                                         const std::string & default_help) const;
 
   /// like optional_value, but for a (mutually exclusive) vector of options
-  template<class T> Result<T> any_optional_value(const std::vector<std::string> & opts) const;
+  template<class T> Result<T> any_optional_value(const OptionNames & opts) const;
+
+  /// like value_all, but for a vector of options (which may all be present)
+  template<class T> Result<std::vector<T>> any_value_all(const OptionNames & opts) const;
 
   /// like value_prefix, but for a (mutually exclusive) vector of options
-  template<class T> Result<T> any_value_prefix(const std::vector<std::string> & opts, 
+  template<class T> Result<T> any_value_prefix(const OptionNames & opts, 
                                                const std::string & prefix) const;
 
   /// like value (with prefix), but for a (mutually exclusive) vector of options
-  template<class T> Result<T> any_value(const std::vector<std::string> & opt, const T & defval, 
-                                    const std::string & prefix) const;
+  template<class T> Result<T> any_value(const OptionNames & opts, const T & defval, 
+                                        const std::string & prefix) const;
 
   ///@}
   
@@ -424,17 +768,42 @@ class CmdLine {
   
   /// return a reference to the std::vector of command-line arguments (0 is
   /// command).
-  inline const std::vector<std::string> & arguments() const {return __arguments;}
+  const std::vector<std::string> & arguments() const;
 
   /// return the full command line
   std::string command_line() const;
 
   /// return the command (i.e. program) name
-  std::string command_name() const {return __arguments[0];}
+  std::string command_name() const {
+    return __subcommand_of.size() == 0 ? __parsed->arguments[0] : __parsed->arguments[0] + " " + __subcommand_of;
+  }
+
+  /// @brief returns a shell completion script (shell = bash, zsh or fish)
+  /// for the options queried so far, including their aliases, argument
+  /// names and choices, as well as any subcommands
+  ///
+  /// The script is also printed by assert_all_options_used() (followed
+  /// by an exit) if the program is run with --cmdline-completion shell,
+  /// e.g. "prog --cmdline-completion bash > prog.bash". It throws for
+  /// the CmdLine of a subcommand, i.e. if --cmdline-completion is given
+  /// after the subcommand.
+  std::string completion_script(const std::string & shell) const;
+
+  /// @brief returns a JSON description of the options queried so far
+  /// (their aliases, kind, type, default, choices, range, etc.) and of
+  /// any subcommands, as read by the cmdline-validate program to check
+  /// argfiles without running the program
+  ///
+  /// The schema is also printed by assert_all_options_used() (followed
+  /// by an exit) if the program is run with --cmdline-schema.
+  std::string schema() const;
 
   /// print the help std::string that has been deduced from all the options called
-  void print_help(std::ostream & ostr = std::cout, bool markdown = false) const;
-  void print_markdown(std::ostream & ostr = std::cout) const;
+  /// (overloads without ostr print to std::cout)
+  void print_help(std::ostream & ostr, bool markdown = false) const;
+  void print_help() const;
+  void print_markdown(std::ostream & ostr) const;
+  void print_markdown() const;
 
   /// return a std::string in argfile format that contains all
   /// options queried and, where relevant, their values
@@ -450,10 +819,29 @@ class CmdLine {
                    const std::string & presence_prefix = "",
                    bool compact = false
                   ) const;
+
+  /// @brief reads back the options of a dump() made with the given
+  /// prefix (and the default absence and presence prefixes), e.g. at the
+  /// top of an output file.
+  ///
+  /// Lines are read from input up to the one that starts with prefix +
+  /// "argfile for " (searching at most max_search_lines lines), and
+  /// then, as for an argfile, up to the end of the dump, i.e. an empty
+  /// line, so that the rest of a long output is not read.
+  ///
+  /// @return the (option, value) pairs of the options in the dump, with
+  /// an empty value for options without a value, and with the options of
+  /// a subcommand given as "name -opt"; commented-out (absent) options and
+  /// positional arguments are not included. The result is empty if no
+  /// dump was found.
+  static std::vector<std::pair<std::string,std::string>> read_dump(std::istream & input, 
+                                          const std::string & prefix = "# ",
+                                          size_t max_search_lines = 10000);
   
   /// return true if all options have been asked for at some point or other
-  /// and send diagnostic info to ostr
-  bool all_options_used(std::ostream & ostr = std::cerr) const;
+  /// and send diagnostic info to ostr (or to std::cerr if ostr is omitted)
+  bool all_options_used(std::ostream & ostr) const;
+  bool all_options_used() const;
 
   /// gives an error if there are unused options
   void assert_all_options_used() const;
@@ -465,9 +853,40 @@ class CmdLine {
   std::string time_stamp_at_start(bool utc = false) const;
 
   /// return the elapsed time in seconds since the CmdLine object was
-  /// created
+  /// created (from a monotonic clock, with sub-microsecond resolution)
   double time_elapsed_since_start() const;
 
+  /// return the time of construction of the CmdLine object, in ns since
+  /// the Unix epoch
+  int64_t time_at_start_ns() const {return __start_system_ns;}
+
+  /// return the elapsed time in ns since the CmdLine object was created
+  int64_t ns_elapsed_since_start() const;
+
+  class PhaseTimer;
+
+  /// @brief starts timing a named phase of the program (e.g.
+  /// "configuration", "compute"), which ends when the returned timer
+  /// is destroyed or its stop() is called.
+  ///
+  /// Phases may be nested and may be timed on several threads; each one
+  /// is recorded for phase_summary() and chrome_trace(). Clones made
+  /// with with_overrides(...) and subcommands share the records of their
+  /// parent.
+  PhaseTimer phase(const std::string & name) const;
+
+  /// @brief returns, in the style of header(), the number of times each
+  /// phase was timed and its total duration, in the order in which the
+  /// phases first started, followed by the elapsed time since start
+  std::string phase_summary(const std::string & prefix = "# ") const;
+
+  /// @brief returns the recorded phases in Chrome trace-event JSON
+  /// format, with times relative to the construction of the CmdLine,
+  /// for viewing e.g. in chrome://tracing or https://ui.perfetto.dev
+  std::string chrome_trace() const;
+  /// writes chrome_trace() to the file (throws a CmdLine::Error on failure)
+  void write_chrome_trace(const std::string & filename) const;
+
   /// return output similar to that from uname -a on unix
   std::string unix_uname() const;
 
@@ -501,19 +920,101 @@ class CmdLine {
   /// - the start time
   /// - the user
   /// - the system name
+  /// - the configuration fingerprint()
   /// The header includes a final newline
   std::string header(const std::string & prefix = "# ") const;
+
+  /// @brief returns a 128-bit hash (as 32 hexadecimal digits) of the
+  /// effective configuration: the canonical name, type, presence and
+  /// value (including defaults) of every queried option, as well as
+  /// notes about the content that values refer to (e.g. list files), and
+  /// the same for any subcommand.
+  ///
+  /// The fingerprint does not depend on the order of the options, on the
+  /// alias used on the command line, on how values were written (e.g.
+  /// 1.0 v. 1) or on no_dump() options. It is included in header() and
+  /// dump(), so that outputs can be identified by their configuration.
+  std::string fingerprint() const;
+
+  /// @brief returns true if the file exists and contains this CmdLine's
+  /// fingerprint() as written by header() or dump() (e.g. an output of an
+  /// earlier run with the same configuration)
+  bool fingerprint_exists(const std::string & filename) const;
+
+  /// resources used by the process so far; entries that are not
+  /// available on the system are set to -1
+  struct ResourceUsage {
+    double user_cpu_s = -1;          ///< user CPU time
+    double system_cpu_s = -1;        ///< system CPU time
+    int64_t peak_rss_bytes = -1;     ///< peak resident set size
+    int64_t major_faults = -1;       ///< page faults that required I/O
+    int64_t minor_faults = -1;       ///< page faults without I/O
+    int64_t read_bytes = -1;         ///< bytes read (by read(), pread(), etc.)
+    int64_t written_bytes = -1;      ///< bytes written (by write(), etc.)
+    int64_t storage_read_bytes = -1; ///< bytes fetched from storage
+    int64_t storage_written_bytes = -1; ///< bytes sent to storage
+    int64_t voluntary_context_switches = -1;
+    int64_t involuntary_context_switches = -1;
+  };
+
+  /// returns the resources used by the process so far, from getrusage
+  /// and (on Linux) /proc/self/status and /proc/self/io
+  static ResourceUsage resource_usage();
+
+  /// return a multiline footer, to go with the header(), that contains
+  /// - the end time and the elapsed time since the start
+  /// - the user and system CPU time
+  /// - the peak resident memory and the number of page faults
+  /// - the bytes read and written
+  /// - the number of voluntary and involuntary context switches
+  /// The footer includes a final newline
+  std::string footer(const std::string & prefix = "# ") const;
+
+  /// arranges for the footer() to be written to std::cout when the
+  /// program exits normally (via exit() or returning from main); only
+  /// the last call has an effect, and the CmdLine need not outlive it.
+  void footer_at_exit(const std::string & prefix = "# ") const;
   
   /// @brief  split a string at spaces, treating multiple spaces as one, and returning a vector of the items
   /// @param str the string to split
   /// @return the vector of individual items
+  ///
+  /// Quotes and other whitespace are not treated specially (cf. tokenize)
   static std::vector<std::string> split_at_spaces(const std::string & str);
 
+  class Tokens;
+
+  /// @brief  split a string into arguments as a shell would: at any
+  /// whitespace, with single quotes ('...' is taken literally), double
+  /// quotes (in "...", a backslash escapes only " \ $ and `) and
+  /// backslash escapes outside quotes; a quoted empty string gives an
+  /// empty argument. Throws a CmdLine::Error for an unterminated quote.
+  ///
+  /// This is used by the CmdLine(const std::string &) constructor, so
+  /// that e.g. the result of command_line() can be parsed back.
+  /// @param str the string to split
+  /// @return the tokens, which refer to a single buffer that they own
+  static Tokens tokenize(const std::string & str);
+
   ///@}
 
 
   class Error;
 
+  class Sweep;
+
+  class ListFile;
+
+  template<class T> class MappedArray;
+
+  /// return the index of the sweep point selected with --sweep-index
+  /// (or --sweep-size), or -1 if no sweep point was selected
+  long long sweep_index() const {return __sweep_index;}
+
+  /// return the total number of points in the sweep described by the
+  /// command line (1 if no sweep point was selected)
+  uint64_t sweep_size() const {return __sweep_size;}
+
   /// take a string and return a wrapped version of it (with the given prefix on each line).
   /// - \n triggers newline preceded by prefix
   /// - no end of line is added to the final line
@@ -528,7 +1029,7 @@ class CmdLine {
 
   /// true if the option is present and corresponds to a value
   [[deprecated("use CmdLine::optional_value instead, and then query the result to see if the argument was present")]]
-  bool present_and_set(const std::string & opt) const {return internal_present_and_set(opt);}
+  bool present_and_set(const OptionNames & opts) const {return internal_present_and_set(opts);}
 
   /// return the integer value corresponding to the given option
   [[deprecated]]
@@ -555,6 +1056,7 @@ class CmdLine {
 
   /// @brief  struct containing static variables for terminal control codes
   struct tc;
+  class TerminalCode;
 
 
  private:
@@ -562,52 +1064,178 @@ class CmdLine {
   /// returns the stdout (and stderr) from the command
   std::string stdout_from_command(std::string cmd) const;
 
-  /// check if the option is present --  for internal use only (does not set help)
-  /// returns
+  /// check if any of the (mutually exclusive) options is present -- for
+  /// internal use only (does not set help); returns
   /// - (-1,-1) if the option is not present
   /// - ( n,-1) if the option is present (at index n) but cannot be associated with a value
   /// - ( n, m) if the option is present (at index n) and can be associated with a value (at index m)
-  std::pair<int,int> internal_present(const std::string & opt) const;
+  /// and throws an error if several of the options are present
+  std::pair<int,int> internal_present(const OptionNames & opts) const;
 
-  /// same as the scalar version of internal_present, but for a vector
-  /// of options, returning similarly if none or one of the options is found
-  /// and throwing an error if multiple options are found
-  std::pair<int,int> internal_present(const std::vector<std::string> & opts) const;
+  /// returns the locations of all occurrences of any of opts (and of their
+  /// possible values), ordered by position (an override in a clone replaces
+  /// all earlier occurrences of the same option)
+  std::vector<std::pair<int,int>> internal_present_all(const OptionNames & opts) const;
 
 
   /// true if the option is present and corresponds to a value (internal use only)
-  bool         internal_present_and_set(const std::string & opt) const;
+  bool         internal_present_and_set(const OptionNames & opts) const;
 
   /// returns string value of option (assumed to be present_and_set) 
   /// -- for internal use only (does not set help)
-  std::string internal_string_val(const std::vector<std::string> & opt) const;
-  std::string internal_string_val(const std::string & opt) const {
-    return internal_string_val(std::vector<std::string>{opt});
-  }
+  const std::string & internal_string_val(const OptionNames & opts) const;
+
+  /// returns a view of the positional arguments, marking them as used and 
+  /// checking their number (the name is used only in error messages)
+  ArgView __positional_view(const std::string & name, unsigned min_count, unsigned max_count) const;
+
+  /// read-only memory mapping of a file
+  class MappedFile;
+
+  /// returns a read-only mapping of the file, shared with all other
+  /// users of the same file in the process
+  static std::shared_ptr<const MappedFile> __mapped_file(const std::string & filename);
+
+  /// returns the object registered under key, if it is still in use
+  /// somewhere in the process, otherwise creates it with create() and
+  /// registers it (only weak references are held by the registry)
+  static std::shared_ptr<const void> __shared_object(const std::string & key,
+                                   const std::function<std::shared_ptr<const void>()> & create);
+
+  /// returns the canonical absolute path of filename (or filename itself
+  /// if that fails)
+  static std::string __canonical_path(const std::string & filename);
+
+  /// true if the filename ends in .bin or .raw
+  static bool __is_binary_filename(const std::string & filename);
+
+  /// 64-bit FNV-1a hash of the n bytes starting at data
+  static uint64_t __fnv1a_64(const char * data, size_t n);
 
   /// returns converted value of option (assumed to be present_and_set) 
   /// -- for internal use only (does not set help)
-  template<class T> T internal_value(const std::string & opt, const std::string & prefix = "") const {
-    return internal_value<T>(std::vector<std::string>{opt}, prefix);
-  }
-  template<class T> T internal_value(const std::vector<std::string> & opt, const std::string & prefix = "") const;
+  template<class T> T internal_value(const OptionNames & opts, const std::string & prefix = "") const;
 
 
 
-  /// stores the command line arguments in a C++ friendly way
-  std::vector<std::string> __arguments;
+  /// a map from option names, ordered with std::less<> so that it can be
+  /// searched with an OptionName, without building a std::string
+  template<class V> using OptionMap = std::map<std::string, V, std::less<>>;
 
-  /// a map of possible options found on the command line, referencing
-  /// the index of the argument that might assign a value to that
-  /// option (an option being anything starting with a dash)
-  ///
-  /// The first element of the pair is the location is the option,
-  /// the second is the location of its value (or -1 if there is no value)
-  mutable std::map<std::string,std::pair<int,int>> __options;
-  
+  /// the command-line arguments, the index of the options found among
+  /// them and the full command line. These are built by init() and
+  /// thereafter only read, so that they can be shared with any clones
+  /// made by with_overrides(...)
+  struct Parsed {
+    /// the command line arguments in a C++ friendly way (0 is the command)
+    std::vector<std::string> arguments;
+
+    /// a map of possible options found on the command line, referencing
+    /// the index of the argument that might assign a value to that
+    /// option (an option being anything starting with a dash)
+    ///
+    /// The first element of the pair is the location is the option,
+    /// the second is the location of its value (or -1 if there is no value)
+    OptionMap<std::pair<int,int>> options;
+
+    /// the whole command line, with arguments quoted where needed
+    std::string command_line;
+
+    /// for each argument that is an option, the location of the previous
+    /// occurrence of the same option (-1 if there is none, or if the
+    /// argument is not an option)
+    std::vector<int> previous_occurrence;
+
+    /// the location of a standalone "--", after which no argument is
+    /// considered to be an option (-1 if there is none)
+    int end_of_options = -1;
+  };
+  std::shared_ptr<Parsed> __parsed;
+
+  /// the options on the command line and the help records whose names
+  /// start with the prefix of a Scope, each sorted by the rest of the
+  /// name, which is all that the scope's lookups compare
+  struct ScopeIndex {
+    std::string prefix;
+    /// the parsed arguments that the options refer to
+    std::shared_ptr<const Parsed> parsed;
+    /// the options present (with overrides taking precedence), by the
+    /// name after the prefix, with their location (cf. Parsed::options)
+    std::vector<std::pair<OptionName, std::pair<int,int>>> options;
+    /// the help records of the options of the scope, by the name after the prefix
+    std::vector<std::pair<OptionName, OptionHelp *>> help;
+
+    /// true if name starts with the prefix, with the rest of it in suffix
+    bool in_scope(OptionName name, OptionName & suffix) const;
+    /// the location of the option with the given suffix, or nullptr if it is absent
+    const std::pair<int,int> * find_option(OptionName suffix) const;
+    /// the help of the option with the given suffix, or nullptr if there is none
+    OptionHelp * find_help(OptionName suffix) const;
+  };
+  /// the index of the Scope through which a query is being made, if any
+  mutable const ScopeIndex * __scope_index = nullptr;
+
+  /// arguments and option index for the overrides of a clone made by
+  /// with_overrides(...); override arguments are numbered after the
+  /// parsed arguments and take precedence over them
+  std::vector<std::string> __override_arguments;
+  OptionMap<std::pair<int,int>> __override_options;
+  std::string __override_command_line;
+  /// locations of options (and their values) shadowed by overrides
+  std::vector<std::pair<int,int>> __shadowed_options;
+
+  /// nodes of a std::map kept for reuse by reset(), so that refilling
+  /// the map with similar keys needs no memory allocation (before C++17,
+  /// without node extraction, the map is simply cleared and refilled).
+  /// Copies of a CmdLine start with an empty pool.
+  template<class Map> struct MapNodes {
+    MapNodes() {}
+    MapNodes(const MapNodes &) {}
+    MapNodes(MapNodes &&) = default;
+    MapNodes & operator=(const MapNodes &) {return *this;}
+    MapNodes & operator=(MapNodes &&) = default;
+#if __cplusplus >= 201703L
+    std::vector<typename Map::node_type> nodes;
+    /// moves all the entries of map into the pool
+    void recycle(Map & map) {
+      while (!map.empty()) nodes.push_back(map.extract(map.begin()));
+    }
+    /// returns map[key], using a node from the pool if key is absent
+    typename Map::mapped_type & entry(Map & map, const std::string & key) {
+      auto iter = map.find(key);
+      if (iter != map.end()) return iter->second;
+      if (nodes.size() == 0) return map[key];
+      auto node = std::move(nodes.back());
+      nodes.pop_back();
+      node.key() = key;
+      node.mapped() = typename Map::mapped_type();
+      return map.insert(std::move(node)).position->second;
+    }
+#else
+    void recycle(Map & map) {map.clear();}
+    typename Map::mapped_type & entry(Map & map, const std::string & key) {return map[key];}
+#endif
+  };
+  MapNodes<OptionMap<std::pair<int,int>>> __option_nodes;
+  MapNodes<OptionMap<bool>> __options_used_nodes;
+  /// parsed and override arguments together, built on demand by arguments()
+  mutable std::vector<std::string> __all_arguments;
+
+  /// the number of arguments, including overrides
+  int __n_arguments() const {return int(__parsed->arguments.size() + __override_arguments.size());}
+  /// argument i, where i may refer to one of the overrides
+  const std::string & __argument(int i) const {
+    int n_parsed = __parsed->arguments.size();
+    return i < n_parsed ? __parsed->arguments[i] : __override_arguments[i-n_parsed];
+  }
+  /// returns a pointer to the location of opt and its possible value
+  /// (cf. Parsed::options), or nullptr if opt is absent
+  const std::pair<int,int> * __find_option(OptionName opt) const;
 
   /// whether a given option has been requested
-  mutable std::map<std::string,bool> __options_used;
+  mutable OptionMap<bool> __options_used;
+  /// records that opt has been requested
+  void __set_option_used(OptionName opt) const;
   /// whether a given argument has been used
   mutable std::vector<bool> __arguments_used;
 
@@ -617,12 +1245,34 @@ class CmdLine {
   bool __help_requested = false;
   /// whether the user has requested markdown help with --help-markdown
   bool __markdown_help = false;
+  /// the shell requested with --cmdline-completion (empty if none)
+  std::string __completion_shell;
+  /// whether the user has requested the schema with --cmdline-schema
+  bool __schema_requested = false;
   /// whether the git info is included or not
   bool __git_info_enabled;
 
+  /// names and help strings of the registered subcommands
+  std::vector<std::pair<std::string,std::string>> __subcommands;
+  /// the name and nested CmdLine of the selected subcommand
+  std::string __subcommand_name;
+  std::shared_ptr<CmdLine> __subcommand;
+  /// for a nested CmdLine, the name of the subcommand that it handles
+  std::string __subcommand_of;
+  /// returns the position of the argument that would be a subcommand, or -1
+  int __subcommand_position() const;
+
   //std::string __progname;
-  std::string __command_line;
   std::time_t __time_at_start;
+  /// the time at start from a monotonic clock (in ns since an arbitrary
+  /// origin) and from the system clock (in ns since the Unix epoch)
+  int64_t __start_steady_ns = 0;
+  int64_t __start_system_ns = 0;
+  /// records the start time in all of the above
+  void __record_start_time();
+  /// the phases timed with phase(...), shared with clones and subcommands
+  struct Timings;
+  std::shared_ptr<Timings> __timings;
   std::string __overall_help_string;
   bool        __fussy = false;
 
@@ -640,6 +1290,19 @@ class CmdLine {
   /// from a file
   static std::string _default_argfile_option;
   std::string __argfile_option = _default_argfile_option;
+
+  /// options used to select a single point of a parameter sweep,
+  /// to request the number of points in the sweep, and to ask for the
+  /// swept arguments to be zipped rather than combined as a Cartesian product
+  static std::string _sweep_index_option, _sweep_size_option, _sweep_zip_option;
+  long long __sweep_index = -1;
+  uint64_t  __sweep_size  = 1;
+  bool      __sweep_size_requested = false;
+
+  /// if the arguments contain one of the sweep options, replace them
+  /// with the arguments for the selected point of the sweep; problems
+  /// are handled as for init
+  bool __expand_sweep(ParseError * error);
   
   /// a struct to help organise sections and subsections for options
   struct OptSection {
@@ -654,15 +1317,19 @@ class CmdLine {
   /// and the level of indentation
   std::vector<OptSection> organised_options() const;
 
+  /// sets the choices of help to the names from CmdLine_value_names<T>, if any
   template<class T>
-  OptionHelp OptionHelp_value_with_default(const std::vector<std::string> & options, const T & default_value,
+  static void __set_automatic_choices(OptionHelp & help) {
+    help.choices = CmdLine_value_names<T>::names();
+    help.automatic_choices = help.choices.size() != 0;
+  }
+  template<class T>
+  OptionHelp OptionHelp_value_with_default(const OptionNames & options, const T & default_value,
                                      const std::string & help_string = "") const {
     OptionHelp help;
-    help.option        = options[0];
-    help.aliases       = options;
-    std::ostringstream defval_ostr;
-    defval_ostr << default_value;
-    help.default_value = defval_ostr.str();
+    help.option        = options[0].str();
+    help.aliases       = options.strings();
+    help.default_value = CmdLine_value_to_string(default_value);
     help.help          = help_string;
     help.type          = typeid(T).name();
     help.required      = false;
@@ -671,14 +1338,33 @@ class CmdLine {
     help.kind          = OptKind::value_with_default;
     help.section       = __current_section;
     help.subsection    = __current_subsection;
+    __set_automatic_choices<T>(help);
     return help;
   }
   template<class T>
-  OptionHelp OptionHelp_value_required(const std::vector<std::string> & options,
+  OptionHelp OptionHelp_value_or_else(const OptionNames & options, 
+                                      const std::string & default_string) const {
+    OptionHelp help;
+    help.option        = options[0].str();
+    help.aliases       = options.strings();
+    help.default_value = default_string;
+    help.help          = "";
+    help.type          = typeid(T).name();
+    help.required      = false;
+    help.takes_value   = true;
+    help.has_default   = true;
+    help.kind          = OptKind::value_with_default;
+    help.section       = __current_section;
+    help.subsection    = __current_subsection;
+    __set_automatic_choices<T>(help);
+    return help;
+  }
+  template<class T>
+  OptionHelp OptionHelp_value_required(const OptionNames & options,
                                        const std::string & help_string = "") const {
     OptionHelp help;
-    help.option        = options[0];
-    help.aliases       = options;
+    help.option        = options[0].str();
+    help.aliases       = options.strings();
     help.default_value = "";
     help.help          = help_string;
     help.type          = typeid(T).name();
@@ -688,14 +1374,15 @@ class CmdLine {
     help.kind          = OptKind::required_value;
     help.section       = __current_section;
     help.subsection    = __current_subsection;
+    __set_automatic_choices<T>(help);
     return help;
   }
   template<class T>
-  OptionHelp OptionHelp_optional_value(const std::vector<std::string> & options,
+  OptionHelp OptionHelp_optional_value(const OptionNames & options,
                                        const std::string & help_string = "") const {
     OptionHelp help;
-    help.option        = options[0];
-    help.aliases       = options;
+    help.option        = options[0].str();
+    help.aliases       = options.strings();
     help.default_value = "";
     help.help          = help_string;
     help.type          = typeid(T).name();
@@ -705,13 +1392,51 @@ class CmdLine {
     help.kind          = OptKind::optional_value;
     help.section       = __current_section;
     help.subsection    = __current_subsection;
+    __set_automatic_choices<T>(help);
+    return help;
+  }
+  template<class T>
+  OptionHelp OptionHelp_all_values(const OptionNames & options,
+                                   const std::string & help_string = "") const {
+    OptionHelp help;
+    help.option        = options[0].str();
+    help.aliases       = options.strings();
+    help.default_value = "";
+    help.help          = help_string;
+    help.type          = typeid(T).name();
+    help.required      = false;
+    help.takes_value   = true;
+    help.has_default   = false;
+    help.kind          = OptKind::all_values;
+    help.section       = __current_section;
+    help.subsection    = __current_subsection;
+    __set_automatic_choices<T>(help);
     return help;
   }
-  OptionHelp OptionHelp_present(const std::vector<std::string> & options,
+  template<class T>
+  OptionHelp OptionHelp_positional(const std::string & name, unsigned min_count, unsigned max_count) const {
+    OptionHelp help;
+    help.option        = name;
+    help.aliases       = {name};
+    help.default_value = "";
+    help.argname       = name;
+    help.type          = typeid(T).name();
+    help.required      = min_count > 0;
+    help.takes_value   = true;
+    help.has_default   = false;
+    help.kind          = OptKind::positional;
+    help.min_count     = min_count;
+    help.max_count     = max_count;
+    help.section       = __current_section;
+    help.subsection    = __current_subsection;
+    __set_automatic_choices<T>(help);
+    return help;
+  }
+  OptionHelp OptionHelp_present(const OptionNames & options,
                                 const std::string & help_string = "") const {
     OptionHelp help;
-    help.option        = options[0];
-    help.aliases       = options;
+    help.option        = options[0].str();
+    help.aliases       = options.strings();
     help.default_value = "";
     help.help          = help_string;
     help.type          = "";
@@ -729,18 +1454,75 @@ class CmdLine {
   /// (if help is disabled, return a null poiner)
   OptionHelp * opthelp_ptr(const OptionHelp & opthelp) const;
 
+  /// as opthelp_ptr(opthelp), but with the help built by make_opthelp()
+  /// only if the option (opts[0]) has not been registered yet, so that
+  /// repeated queries do not copy the names, type, section, etc. For
+  /// options of kind value_with_default, default_value is checked
+  /// against that of the existing registration.
+  template<class F> 
+  OptionHelp * opthelp_ptr(const OptionNames & opts, OptKind kind, const std::string & default_value,
+                           const F & make_opthelp) const {
+    if (!__help_enabled) return nullptr;
+    OptionHelp * result = __registered_opthelp(opts[0], kind, default_value);
+    return result ? result : opthelp_ptr(make_opthelp());
+  }
+
+  /// returns the existing opthelp for option, after checking that it
+  /// has the given kind and default value, or nullptr if there is none
+  OptionHelp * __registered_opthelp(OptionName option, OptKind kind, 
+                                    const std::string & default_value) const;
+
   /// return a pointer to an existing option help record matching opt
   /// directly or through one of its aliases
-  const OptionHelp * existing_opthelp_ptr(const std::string & opt) const;
+  const OptionHelp * existing_opthelp_ptr(OptionName opt) const;
 
   /// a std::vector of the options queried (this may evolve)
   mutable std::vector<std::string> __options_queried;
   /// a map with help for each option that was queried
-  mutable std::map<std::string, OptionHelp> __options_help;
+  mutable OptionMap<OptionHelp> __options_help;
   
 
-  /// builds the internal structures needed to keep track of arguments and options
-  void init();
+  /// makes result the latest result of its option (cf. OptionHelp::result_ptr) and returns it
+  template<class T> Result<T> __record_result(OptionHelp * opthelp, Result<T> && result) const;
+
+  /// common part of try_value(opt) and try_value(opt, defval), with
+  /// defval = nullptr for the former
+  template<class T> Expected<T> __try_value(OptionName opt, OptionHelp * opthelp, 
+                                            const T * defval) const;
+
+  /// builds the internal structures needed to keep track of arguments
+  /// and options; problems are recorded in *error if error is not null
+  /// (in which case the function returns false), otherwise they throw
+  bool init(ParseError * error = nullptr);
+  /// the part of init that processes the arguments (argfiles, sweeps)
+  /// and builds the option index, also used by reset
+  bool __parse_arguments(ParseError * error);
+
+  /// registers the options that request help and records whether they
+  /// are present; problems are handled as for init
+  bool __register_help_options(ParseError * error = nullptr);
+
+  /// returns arg, quoted if need be for inclusion in the command line
+  static std::string __quoted(const std::string & arg);
+  /// appends __quoted(arg) to str, without a temporary string
+  static void __append_quoted(std::string & str, const std::string & arg);
+
+  /// splits str into tokens (cf. tokenize); returns false, with the
+  /// position of the unterminated quote in error_position, on failure
+  static bool __tokenize(const std::string & str, Tokens & tokens, size_t & error_position);
+
+  /// returns str with the characters that need it escaped for inclusion
+  /// in a JSON string
+  static std::string __json_escaped(const std::string & str);
+  /// one string per queried option (and subcommand option) that
+  /// identifies its effective value, sorted, for the fingerprint()
+  std::vector<std::string> __fingerprint_entries() const;
+  /// the footer(), for a CmdLine started at start_steady_ns
+  static std::string __footer(const std::string & prefix, int64_t start_steady_ns);
+
+  /// records whether the options that request help are present, once
+  /// they have been registered by __register_help_options
+  void __update_help_flags();
 
   /// report failure of conversion (throws a CmdLine::Error)
   [[ noreturn ]] void _report_conversion_failure(const std::string & opt, 
@@ -748,7 +1530,7 @@ class CmdLine {
 
   /// convert the time into a std::string (local by default -- utc if 
   /// utc=true).
-  std::string _string_time(const time_t & time, bool utc) const;
+  static std::string _string_time(const time_t & time, bool utc);
 
 };
 
@@ -768,329 +1550,814 @@ private:
   static bool _do_printout;
 };
 
-template<class T> 
-void CmdLine::Result<T>::throw_value_not_available() const {
-  std::ostringstream ostr;
-  ostr << "value of option ";
-  if (_opthelp) ostr << _opthelp->option;
-  else ostr << "[unknown -- because help disabled]";
-  ostr << " requested, but that value is not available\n"
-       << "because the option was not present on the command line and no default was supplied\n";
-  throw Error(ostr.str());
-}
+//----------------------------------------------------------------------
+/// class that describes a problem with the command line, as reported by
+/// CmdLine::try_parse and CmdLine::try_value; it records the kind of
+/// problem, the option concerned and its position among the arguments,
+/// and only formats a message when message() is called
+class CmdLine::ParseError {
+public:
+  enum Code {
+    none = 0,           ///< no error
+    bad_command_name,   ///< the command name (0th argument) is empty or starts with a -
+    bad_quoting,        ///< the command-line string has an unterminated quote
+    argfile_not_found,  ///< the file for the argfile option is missing or unreadable
+    bad_sweep,          ///< the sweep options or the swept arguments are invalid
+    bad_value,          ///< the value of one of CmdLine's own options is invalid
+    option_absent,      ///< a required option is absent
+    value_absent,       ///< an option is present, but not followed by a value
+    conversion_failure  ///< the value could not be converted to the requested type
+  };
 
+  ParseError() {}
+  ParseError(Code code, const std::string & option, int position, 
+             const std::string & value = "", const char * type_name = nullptr) :
+    _code(code), _option(option), _position(position), _value(value), _type_name(type_name) {}
+
+  /// the kind of error
+  Code code() const {return _code;}
+  /// the option concerned (may be empty)
+  const std::string & option() const {return _option;}
+  /// the position of the offending argument, or -1 if not known (for
+  /// bad_quoting, the position of the quote in the command-line string)
+  int position() const {return _position;}
+  /// the offending value, or further detail (may be empty)
+  const std::string & value() const {return _value;}
+  /// true if there is an error
+  explicit operator bool() const {return _code != none;}
+  /// the error message, formatted as for the corresponding CmdLine::Error
+  std::string message() const;
 
-template<class T>
-inline CmdLine::Result<T>::operator T() const {
-  return value();
-}
+private:
+  Code _code = none;
+  std::string _option;
+  int _position = -1;
+  std::string _value;
+  const char * _type_name = nullptr;
+};
 
-template<class T>
-inline T CmdLine::Result<T>::operator()() const {
-  return value();
-}
+//----------------------------------------------------------------------
+/// class that holds either a value of type T or the CmdLine::ParseError
+/// that prevented it from being obtained
+template<class T> class CmdLine::Expected {
+public:
+  Expected(const T & value) : _value(value) {}
+  Expected(T && value) : _value(std::move(value)) {}
+  Expected(const ParseError & error) : _error(error) {}
+  Expected(ParseError && error) : _error(std::move(error)) {}
+
+  /// true if there is a value (i.e. no error)
+  bool has_value() const {return !_error;}
+  explicit operator bool() const {return has_value();}
+
+  /// the value; throws a CmdLine::Error with the error message if
+  /// there is no value
+  const T & value() const & {_check(); return _value;}
+  T & value() & {_check(); return _value;}
+  T && value() && {_check(); return std::move(_value);}
+  const T & operator*() const {return _value;}
+  const T * operator->() const {return &_value;}
+  T * operator->() {return &_value;}
+
+  /// the value if there is one, otherwise alternative
+  T value_or(const T & alternative) const {return has_value() ? _value : alternative;}
+
+  /// the error (code() == ParseError::none if there is a value)
+  const ParseError & error() const {return _error;}
 
-template<class T>
-inline T CmdLine::Result<T>::value() const {
-  if (!has_value()) throw_value_not_available();
-  return _t;
-}
+private:
+  void _check() const {if (_error) throw Error(_error.message());}
+  T _value;
+  ParseError _error;
+};
 
-template<class T>
-CmdLine::OptionHelp & CmdLine::Result<T>::opthelp() const {
-  if (_opthelp) {
-    return *_opthelp;
-  } else {
-    throw CmdLine::Error("tried to access optionhelp for option where it does not exist\n"
-                  "(e.g. because option help already set for an identical option earlier)");
-  }
-}
+//----------------------------------------------------------------------
+/// handle to a CmdLine from the thread-local pool of CmdLine::pooled(...),
+/// to which the CmdLine is returned when the handle is destroyed
+class CmdLine::Pooled {
+public:
+  Pooled(Pooled &&) = default;
+  ~Pooled();
+  CmdLine & operator*() const {return *_cmdline;}
+  CmdLine * operator->() const {return _cmdline.get();}
+private:
+  friend class CmdLine;
+  Pooled(std::unique_ptr<CmdLine> cmdline) : _cmdline(std::move(cmdline)) {}
+  std::unique_ptr<CmdLine> _cmdline;
+};
 
-template<class T> inline T CmdLine::value_for_missing_option() const {return T(0);}
-template<> inline std::string CmdLine::value_for_missing_option<std::string>() const {return "";}
+//----------------------------------------------------------------------
+/// view of the options of a CmdLine whose names start with a prefix,
+/// returned by CmdLine::scope(prefix): scope.value<T>("-opt") is
+/// cmdline.value<T>(prefix + "-opt"), recorded as belonging to the
+/// scope for help and dump(). The CmdLine must outlive the scope.
+///
+/// The scope finds the options on the command line that start with its
+/// prefix, and the help records of its options, once (with a lower_bound
+/// on the prefix), and its queries look up their option among these,
+/// comparing only the part of the name after the prefix.
+class CmdLine::Scope {
+public:
+  const std::string & prefix() const {return _index.prefix;}
+  const CmdLine & cmdline() const {return *_cmdline;}
 
+  /// a nested scope, with prefix() + name as its prefix (whose options
+  /// are taken from those of this scope)
+  Scope scope(const std::string & name) const;
 
-/// returns the value of the argument, convertible to type T
-template<class T> CmdLine::Result<T> CmdLine::any_value(const std::vector<std::string> & opts) const {
-  // we create the result from the (more general) value_prefix
-  // function, with an empty prefix
-  return any_value_prefix<T>(opts,"");
-}
+  template<class T> Result<T> value(const std::string & name) const {
+    return _scoped(name, [&](OptionName opt){return _cmdline->value<T>(opt);});
+  }
+  template<class T> Result<T> value(const std::string & name, const T & defval) const {
+    return _scoped(name, [&](OptionName opt){return _cmdline->value<T>(opt, defval);});
+  }
+  template<class T = void, class F> Result<typename CmdLine_or_else_type<T,F>::type> 
+  value_or_else(const std::string & name, const F & default_fn, const std::string & default_help = "") const {
+    return _scoped(name, [&](OptionName opt){return _cmdline->value_or_else<T>(opt, default_fn, default_help);});
+  }
+  template<class T> Result<T> optional_value(const std::string & name) const {
+    return _scoped(name, [&](OptionName opt){return _cmdline->optional_value<T>(opt);});
+  }
+  Result<bool> present(const std::string & name) const {
+    return _scoped(name, [&](OptionName opt){return _cmdline->present(opt);});
+  }
+  Result<bool> value_bool(const std::string & name, bool defval) const {
+    return _scoped(name, [&](OptionName opt){return _cmdline->value_bool(opt, defval);});
+  }
 
-/// returns the value of the argument converted to type T
-template<class T> 
-CmdLine::Result<T> CmdLine::any_value_prefix(const std::vector<std::string> & opts, 
-                                             const std::string & prefix) const {
-  OptionHelp * opthelp = opthelp_ptr(OptionHelp_value_required<T>(opts, ""));
+  /// the names, without the prefix, of the options on the command line
+  /// that are in this scope (cf. CmdLine::options_matching)
+  std::vector<std::string> options() const;
 
-  T result;
-  if (__help_requested && internal_present(opts).second < 0) {
-    result = value_for_missing_option<T>();
-  } else {
-    result = internal_value<T>(opts, prefix);
+private:
+  friend class CmdLine;
+  /// a scope whose options are found in the CmdLine's index, or, for a
+  /// nested scope, among those of the parent scope's index
+  Scope(const CmdLine * cmdline, const std::string & prefix, const ScopeIndex * parent = nullptr);
+
+  /// makes query(prefix + name) with the CmdLine's lookups going through
+  /// the scope's index, and records the option's help in the scope
+  template<class Q> 
+  auto _scoped(const std::string & name, const Q & query) const -> decltype(query(OptionName())) {
+    _update_index();
+    // the full name is assembled in a local buffer when it fits
+    char buffer[128];
+    std::string long_name;
+    OptionName full_name = _full_name(name, buffer, sizeof(buffer), long_name);
+    ActiveIndex active(_cmdline, &_index);
+    auto result = query(full_name);
+    if (result.has_opthelp()) _record_help(result.opthelp());
+    return result;
   }
-  Result<T> res(result, opthelp, true);
-  if (opthelp) opthelp->result_ptr = std::make_shared<Result<T>>(res);
-  return res;
-}
 
+  /// makes index the one used by the CmdLine's lookups while it exists
+  class ActiveIndex {
+  public:
+    ActiveIndex(const CmdLine * cmdline, const ScopeIndex * index) 
+      : _cmdline(cmdline), _previous(cmdline->__scope_index) {cmdline->__scope_index = index;}
+    ~ActiveIndex() {_cmdline->__scope_index = _previous;}
+  private:
+    const CmdLine * _cmdline;
+    const ScopeIndex * _previous;
+  };
 
-template<class T> CmdLine::Result<T> CmdLine::any_value(const std::vector<std::string> & opts, const T & defval) const {
-  // construct help
-  OptionHelp * opthelp = opthelp_ptr(OptionHelp_value_with_default(opts, defval, ""));
+  /// rebuilds the options of the index if the CmdLine's parsed
+  /// arguments have been replaced since it was built (e.g. by reset())
+  void _update_index() const;
+  /// returns prefix + name, in buffer if it fits, otherwise in long_name
+  OptionName _full_name(const std::string & name, char * buffer, size_t buffer_size, 
+                        std::string & long_name) const;
+  /// records the scope in the help, and the help in the index
+  void _record_help(OptionHelp & opthelp) const;
+
+  const CmdLine * _cmdline;
+  mutable ScopeIndex _index;
+};
 
-  std::shared_ptr<Result<T>> res;
-  // return value
-  auto pres = this->internal_present(opts);
-  if (pres.second > 0) {
-    auto result = internal_value<T>(opts);
-    res = std::make_shared<Result<T>>(result,opthelp,true);
-  } else if (pres.first > 0) {
-    throw Error("option " + __arguments[pres.first] + " present, but expected value was absent");
-  } else {
-    res = std::make_shared<Result<T>>(defval,opthelp,false);
+//----------------------------------------------------------------------
+/// timer for a phase of the program, returned by CmdLine::phase(name),
+/// which records the phase when it is stopped or destroyed
+class CmdLine::PhaseTimer {
+public:
+  PhaseTimer(PhaseTimer && other) noexcept;
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer & operator=(const PhaseTimer &) = delete;
+  /// stops the timer; if the phase cannot be recorded (stop() may throw
+  /// on locking or allocation), it is dropped rather than terminating
+  ~PhaseTimer() noexcept {
+    try {stop();} catch (...) {}
   }
-  if (opthelp) opthelp->result_ptr = res;
-  return *res;
-}
+  /// ends and records the phase (only the first call has an effect)
+  void stop();
+  /// the time in seconds since the phase started (until stop() if stopped)
+  double elapsed() const;
+private:
+  friend class CmdLine;
+  PhaseTimer(const std::shared_ptr<Timings> & timings, const std::string & name, int64_t origin_steady_ns);
+  std::shared_ptr<Timings> _timings;
+  std::string _name;
+  /// the start of the CmdLine, and of the phase, from the monotonic clock
+  int64_t _origin_steady_ns;
+  int64_t _start_steady_ns;
+  int64_t _stop_steady_ns = -1;
+};
 
-template<class T> CmdLine::Result<T> CmdLine::any_optional_value(const std::vector<std::string> & opts) const {
-  // construct help
-  OptionHelp * opthelp = opthelp_ptr(OptionHelp_optional_value<T>(opts));
-  if (opthelp) opthelp->default_value = "None";
-
-  // return value
-  std::shared_ptr<Result<T>> res;
-  auto pres = this->internal_present(opts);
-  if (pres.second > 0) {
-    auto result = internal_value<T>(opts);
-    res = std::make_shared<Result<T>>(result, opthelp, true);
-  } else if (pres.first > 0) {
-    throw Error("option " + __arguments[pres.first] + " present, but expected value was absent");
-  } else {    
-    res = std::make_shared<Result<T>>(value_for_missing_option<T>(), opthelp, false);
-  }
-  if (opthelp) opthelp->result_ptr = res;
-  return *res;
-}
+//----------------------------------------------------------------------
+/// class that identifies parameter sweeps in a list of command-line
+/// arguments and gives access to the individual points of the sweep.
+/// An argument is a sweep if it has one of the forms
+///
+/// - `{a,b,c}`: an explicit list of values
+/// - `start:stop:step`: a numerical range, with stop included if reached
+///   (integer if all three numbers are integers, floating-point otherwise)
+///
+/// By default the points are the Cartesian product of all the swept
+/// arguments (with the last one varying fastest); with zip=true the
+/// swept arguments are instead advanced together and must all have the
+/// same number of values. Points are only materialised on request.
+class CmdLine::Sweep {
+public:
+  Sweep(const std::vector<std::string> & args, bool zip = false);
 
+  /// the total number of points in the sweep (1 if there is no sweep)
+  uint64_t size() const {return _size;}
 
-template<class T> CmdLine::Result<T> CmdLine::any_value(const std::vector<std::string> & opts, const T & defval, 
-                                   const std::string & prefix) const {
-  OptionHelp * opthelp = opthelp_ptr(OptionHelp_value_with_default(opts, defval, ""));
+  /// the number of swept arguments
+  unsigned n_dimensions() const {return _dims.size();}
 
-  // return value
-  std::shared_ptr<Result<T>> res;
-  auto pres = this->internal_present(opts);
-  if (pres.second > 0) {
-    auto result = internal_value<T>(opts, prefix);
-    res = std::make_shared<Result<T>>(result, opthelp, true);
-  } else if (pres.first > 0) {
-    throw Error("option " + __arguments[pres.first] + " present, but expected value was absent");
-  } else {
-    res = std::make_shared<Result<T>>(defval, opthelp, false);
-  }
-  if (opthelp) opthelp->result_ptr = res;
-  return *res;
-}
+  /// the arguments corresponding to point ipoint (0 <= ipoint < size())
+  std::vector<std::string> arguments(uint64_t ipoint) const;
 
-template<class T>
-CmdLine::Result<T> CmdLine::reuse_value(const std::string & opt) const {
-  const OptionHelp * opthelp = existing_opthelp_ptr(opt);
-  if (!opthelp) {
-    throw Error("`reuse_value<T>(\"" + opt + "\")` requires " + opt + " to have been"
-                " previously queried with `value<T>(\""+opt+
-                "\" [, ...])`, but no prior query for that option was found");
-  }
-  if (!opthelp->takes_value) {
-    throw Error("option " + opt + " was previously queried, but did not take a value (e.g. used with present())");
-  }
+  /// the value taken by the swept argument idim at point ipoint
+  std::string value(unsigned idim, uint64_t ipoint) const;
 
-  const std::string requested_type = typeid(T).name();
-  if (opthelp->type != requested_type) {
-    throw Error("option " + opt + " was previously queried with type '"
-                + OptionHelp::demangle(opthelp->type)
-                + "' but reuse_value requested type '"
-                + OptionHelp::demangle(requested_type) + "'");
-  }
+  /// returns true if arg has the form of a sweep
+  static bool is_sweep(const std::string & arg);
+
+private:
+  /// one swept argument, either an explicit list or a numerical range
+  struct Dimension {
+    int iarg;
+    std::vector<std::string> values;
+    bool is_integer = false;
+    long long istart = 0, istep = 0;
+    double    dstart = 0, dstep = 0;
+    uint64_t  n = 0;
+    std::string value(uint64_t i) const;
+  };
+  static bool _parse(const std::string & arg, Dimension & dim);
+
+  std::vector<std::string> _args;
+  std::vector<Dimension> _dims;
+  bool _zip;
+  uint64_t _size;
+};
+
+//----------------------------------------------------------------------
+/// class that provides a lightweight view of a subset of the
+/// command-line arguments, returned e.g. by CmdLine::positional_view(...).
+/// It refers to the arguments stored in the CmdLine (and keeps them
+/// alive), without copying them.
+class CmdLine::ArgView {
+public:
+  /// a forward iterator over the arguments in the view
+  class iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::string               value_type;
+    typedef std::ptrdiff_t            difference_type;
+    typedef const std::string *       pointer;
+    typedef const std::string &       reference;
+
+    const std::string & operator*() const {return (*_view->_args)[_iarg];}
+    const std::string * operator->() const {return &(*_view->_args)[_iarg];}
+    iterator & operator++() {
+      if (++_iarg == _view->_runs[_irun].second) {
+        ++_irun;
+        _iarg = _irun < _view->_runs.size() ? _view->_runs[_irun].first : 0;
+      }
+      return *this;
+    }
+    bool operator==(const iterator & other) const {return _irun == other._irun && _iarg == other._iarg;}
+    bool operator!=(const iterator & other) const {return !(*this == other);}
+  private:
+    friend class ArgView;
+    iterator(const ArgView * view, size_t irun, int iarg) : _view(view), _irun(irun), _iarg(iarg) {}
+    const ArgView * _view;
+    size_t _irun;
+    int _iarg;
+  };
+
+  /// the number of arguments in the view
+  size_t size() const {return _size;}
+  /// true if the view contains no arguments
+  bool empty() const {return _size == 0;}
+  /// the i-th argument in the view
+  const std::string & operator[](size_t i) const;
+  /// the position on the command line of the i-th argument in the view
+  int position(size_t i) const;
+
+  iterator begin() const {return iterator(this, 0, _runs.size() != 0 ? _runs[0].first : 0);}
+  iterator end()   const {return iterator(this, _runs.size(), 0);}
+
+private:
+  friend class CmdLine;
+  /// adds the argument at position iarg, which should come after
+  /// all arguments already in the view
+  void _push_back(int iarg);
+
+  std::shared_ptr<const std::vector<std::string>> _args;
+  /// runs of consecutive arguments, [first,second)
+  std::vector<std::pair<int,int>> _runs;
+  size_t _size = 0;
+};
+
+/// conversion of the arguments in a view to a string, separated by spaces
+std::string CmdLine_value_to_string(const CmdLine::ArgView & view);
+/// conversion of the arguments in a view to a vector of strings
+std::vector<std::string> CmdLine_values_to_strings(const CmdLine::ArgView & view);
+
+//----------------------------------------------------------------------
+/// class for option values that are lists of entries, typically input
+/// files, given on the command line as "-input @files.txt", where
+/// files.txt contains one entry per line (blank lines and lines
+/// starting with # are skipped). A value that does not start with @
+/// is a list with just that one entry.
+///
+/// The list file is memory mapped and the entries are located lazily
+/// as one iterates over them, without copying. Only the @files.txt
+/// reference appears in the command line and in dump(), where it is
+/// annotated with the number of entries and a hash of the file content.
+///
+/// Usage:
+/// \code
+///   auto inputs = cmdline.value<CmdLine::ListFile>("-input").help("input files");
+///   for (const auto & input: inputs()) {...}
+/// \endcode
+class CmdLine::ListFile {
+public:
+#if __cplusplus >= 201703L
+  typedef std::string_view entry_type;
+#else
+  typedef std::string entry_type;
+#endif
 
-  auto reused_result = std::dynamic_pointer_cast<Result<T>>(opthelp->result_ptr);
-  if (!reused_result) {
-    throw Error("could not reuse stored value for option " + opt);
+  /// an empty list
+  ListFile() {}
+  /// a list from an option value, either @filename or a single entry
+  ListFile(const std::string & value);
+
+  /// a forward iterator over the entries in the list
+  class iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef entry_type                value_type;
+    typedef std::ptrdiff_t            difference_type;
+    typedef const entry_type *        pointer;
+    typedef entry_type                reference;
+
+    iterator() {}
+    entry_type operator*() const {return entry_type(_pos, size_t(_entry_end - _pos));}
+    iterator & operator++() {_pos = _next; _find_entry(); return *this;}
+    iterator operator++(int) {iterator result = *this; ++*this; return result;}
+    bool operator==(const iterator & other) const {return _pos == other._pos;}
+    bool operator!=(const iterator & other) const {return _pos != other._pos;}
+  private:
+    friend class ListFile;
+    iterator(const char * pos, const char * end) : _pos(pos), _end(end) {_find_entry();}
+    /// moves _pos forward to the next entry (or to _end) and sets
+    /// _entry_end and _next accordingly
+    void _find_entry();
+    const char * _pos = nullptr, * _entry_end = nullptr, * _next = nullptr, * _end = nullptr;
+  };
+
+  iterator begin() const {return iterator(_begin, _end);}
+  iterator end()   const {return iterator(_end, _end);}
+  bool empty() const {return begin() == end();}
+
+  /// the number of entries (counted on the first call)
+  size_t size() const;
+
+  /// the option value from which the list was constructed
+  const std::string & reference() const;
+  /// true if the entries come from a list file
+  bool from_file() const;
+  /// a 64-bit FNV-1a hash of the list file content (or of the single
+  /// entry), computed on the first call
+  uint64_t hash() const;
+
+private:
+  struct Data;
+  std::shared_ptr<Data> _data;
+  const char * _begin = nullptr, * _end = nullptr;
+};
+
+//----------------------------------------------------------------------
+/// the arguments obtained by splitting a string with CmdLine::tokenize;
+/// the tokens (with quotes and escapes removed) are stored one after
+/// the other in a single buffer and accessed as views into it
+class CmdLine::Tokens {
+public:
+#if __cplusplus >= 201703L
+  typedef std::string_view entry_type;
+#else
+  typedef std::string entry_type;
+#endif
+
+  Tokens() {}
+
+  /// a random-access iterator over the tokens
+  class iterator {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef entry_type                      value_type;
+    typedef std::ptrdiff_t                  difference_type;
+    typedef const entry_type *              pointer;
+    typedef entry_type                      reference;
+
+    iterator() {}
+    entry_type operator*() const {return (*_tokens)[_i];}
+    entry_type operator[](difference_type n) const {return (*_tokens)[_i+n];}
+    iterator & operator++() {++_i; return *this;}
+    iterator operator++(int) {iterator result = *this; ++_i; return result;}
+    iterator & operator--() {--_i; return *this;}
+    iterator operator--(int) {iterator result = *this; --_i; return result;}
+    iterator & operator+=(difference_type n) {_i += n; return *this;}
+    iterator & operator-=(difference_type n) {_i -= n; return *this;}
+    iterator operator+(difference_type n) const {return iterator(_tokens, _i+n);}
+    iterator operator-(difference_type n) const {return iterator(_tokens, _i-n);}
+    difference_type operator-(const iterator & other) const {return difference_type(_i) - difference_type(other._i);}
+    bool operator==(const iterator & other) const {return _i == other._i;}
+    bool operator!=(const iterator & other) const {return _i != other._i;}
+    bool operator< (const iterator & other) const {return _i <  other._i;}
+    bool operator> (const iterator & other) const {return _i >  other._i;}
+    bool operator<=(const iterator & other) const {return _i <= other._i;}
+    bool operator>=(const iterator & other) const {return _i >= other._i;}
+  private:
+    friend class Tokens;
+    iterator(const Tokens * tokens, size_t i) : _tokens(tokens), _i(i) {}
+    const Tokens * _tokens = nullptr;
+    size_t _i = 0;
+  };
+
+  /// the number of tokens
+  size_t size() const {return _tokens.size();}
+  /// true if there are no tokens
+  bool empty() const {return _tokens.size() == 0;}
+  /// the i-th token
+  entry_type operator[](size_t i) const {
+    return entry_type(_buffer.data() + _tokens[i].first, _tokens[i].second);
   }
-  return *reused_result;
+  iterator begin() const {return iterator(this, 0);}
+  iterator end()   const {return iterator(this, _tokens.size());}
+
+  /// the tokens as a vector of strings
+  std::vector<std::string> strings() const;
+
+private:
+  friend class CmdLine;
+  /// the tokens, without quotes and escapes, one after the other
+  std::string _buffer;
+  /// the offset in _buffer and the length of each token
+  std::vector<std::pair<size_t,size_t>> _tokens;
+};
+
+/// returns the value from which the list was constructed (e.g. @files.txt)
+template<> std::string CmdLine_value_to_string<CmdLine::ListFile>(const CmdLine::ListFile & list);
+/// for a list file, returns the number of entries and the content hash
+template<> std::string CmdLine_value_annotation<CmdLine::ListFile>(const CmdLine::ListFile & list);
+
+//----------------------------------------------------------------------
+/// class for option values that are large arrays stored in a file,
+/// given on the command line as "-weights @table.bin". Files ending
+/// in .bin or .raw are mapped read-only and their content is used
+/// directly as an array of T (which must then be trivially copyable);
+/// other files are read as whitespace-separated values (with # starting
+/// a comment up to the end of the line), parsed once. A value that does
+/// not start with @ gives an array with that single element.
+///
+/// Copies of the array, and all arrays of the same type in the process
+/// that refer to the same file, share the mapping or the parsed values
+/// (forked children share them too, through copy-on-write). dump()
+/// records the @table.bin reference, annotated with the number of
+/// elements and a hash of the file content.
+///
+/// Usage:
+/// \code
+///   auto weights = cmdline.value<CmdLine::MappedArray<double>>("-weights").help("...");
+///   for (double w: weights()) {...}
+/// \endcode
+template<class T> class CmdLine::MappedArray {
+public:
+  /// an empty array
+  MappedArray() {}
+  /// an array from an option value, either @filename or a single element
+  MappedArray(const std::string & value);
+
+  const T * data() const {return _data;}
+  size_t size() const {return _size;}
+  bool empty() const {return _size == 0;}
+  const T & operator[](size_t i) const {return _data[i];}
+  const T * begin() const {return _data;}
+  const T * end() const {return _data + _size;}
+#if defined(__cpp_lib_span)
+  std::span<const T> span() const {return std::span<const T>(_data, _size);}
+  operator std::span<const T>() const {return span();}
+#endif
+
+  /// the option value from which the array was constructed
+  const std::string & reference() const {return _reference;}
+  /// true if the values come from a file
+  bool from_file() const {return _payload && _payload->from_file;}
+  /// true if the values are mapped directly from a binary file
+  bool binary() const {return _payload && _payload->file;}
+  /// a 64-bit FNV-1a hash of the file content (or of the value
+  /// for a single element)
+  uint64_t hash() const;
+
+private:
+  /// the state shared by all arrays referring to the same file
+  struct Payload {
+    std::shared_ptr<const MappedFile> file; ///< only for binary files
+    std::vector<T> values;                  ///< otherwise
+    bool from_file = false;
+    uint64_t hash = 0;
+  };
+  static void _parse_text(const MappedFile & file, Payload & payload);
+
+  std::shared_ptr<const Payload> _payload;
+  std::string _reference;
+  const T * _data = nullptr;
+  size_t _size = 0;
+};
+
+/// returns the value from which the array was constructed (e.g. @table.bin)
+template<class T> std::string CmdLine_value_to_string(const CmdLine::MappedArray<T> & array);
+/// for arrays read from a file, returns the number of elements and the content hash
+template<class T> std::string CmdLine_value_annotation(const CmdLine::MappedArray<T> & array);
+
+
+template<class T>
+inline CmdLine::Result<T>::operator T() const {
+  return value();
 }
 
 template<class T>
-std::ostream & operator<<(std::ostream & ostr, const CmdLine::Result<T> & result) {
-  ostr << result();
-  return ostr;
+inline const T & CmdLine::Result<T>::operator()() const & {
+  return value();
 }
 
 template<class T>
-std::string CmdLine::Result<T>::value_as_string() const {
-  std::ostringstream ostr;
-  ostr.precision(16);
-  ostr << (*this)();
-  return ostr.str();
+inline T CmdLine::Result<T>::operator()() const && {
+  return value();
 }
 
 template<class T>
-const CmdLine::Result<T> & CmdLine::Result<T>::choices(
-                             const std::vector<T> & allowed_choices,
-                             const std::vector<std::string> & choices_help
-                             ) const {
-
-  // register the choices with the help module
-  if (_opthelp->choices.size() != 0) {
-    if (_opthelp->choices.size() != allowed_choices.size()) {
-      throw Error("For "+ _opthelp->option+ " option, overwriting choices vector must be same size as existing allowed_choices");
-    }
-    for (unsigned i = 0; i < allowed_choices.size(); ++i) {
-      std::ostringstream ostr;
-      ostr << allowed_choices[i];
-      if (_opthelp->choices[i] != ostr.str()) {
-        throw Error("For "+ _opthelp->option+ " option, overwrite choice at index " + std::to_string(i) + " = " + ostr.str() + " must be same as choice already set at that index, " + _opthelp->choices[i]);
-      }
-    }
-  }
-  _opthelp->choices.resize(0);
-  for (const auto & choice: allowed_choices) {
-    std::ostringstream ostr;
-    ostr << choice;
-    _opthelp->choices.push_back(ostr.str());
-  }
-  if (choices_help.size() != 0) {
-    _opthelp->choices_help.resize(0);
-    if (choices_help.size() != allowed_choices.size()) {
-      throw Error("choices_help vector must be same size as allowed_choices vector");
-    }
-    for (size_t i=0; i<choices_help.size(); ++i) {
-      _opthelp->choices_help.push_back(choices_help[i]);
-    }
-  }
+inline const T & CmdLine::Result<T>::value() const & {
+  if (!has_value()) throw_value_not_available();
+  return _t.get();
+}
 
-  // check the choice actually made is valid
-  bool valid = false;
-  for (const auto & choice: allowed_choices) {
-    if (_t == choice) {valid = true; break;}
-  }
-  if (!valid) {
-    std::ostringstream ostr;
-    ostr << "For option " << _opthelp->option << ", invalid option value " 
-        << _t << ". Allowed choices are: " << _opthelp->choice_list();
-    throw Error(ostr.str());
-  }
-  return *this;
+template<class T>
+inline T CmdLine::Result<T>::value() const && {
+  if (!has_value()) throw_value_not_available();
+  return _t.get();
 }
 
 template<class T>
-const CmdLine::Result<T> & CmdLine::Result<T>::range(T minval, T maxval) const {
-  std::ostringstream minstr, maxstr;
-  minstr << minval;
-  maxstr << maxval;
-  _opthelp->range_strings.push_back(minstr.str());
-  _opthelp->range_strings.push_back(maxstr.str());
-  if (_t < minval || _t > maxval) {
-    std::ostringstream errstr;
-    errstr << "For option " << _opthelp->option << ", option value " << _t 
-           << " out of allowed range: " 
-           << _opthelp->range_string();
-    throw Error(errstr.str());
+CmdLine::OptionHelp & CmdLine::Result<T>::opthelp() const {
+  if (_opthelp) {
+    return *_opthelp;
+  } else {
+    throw CmdLine::Error("tried to access optionhelp for option where it does not exist\n"
+                  "(e.g. because option help already set for an identical option earlier)");
   }
-  return *this;
 }
 
+// T(0) for types that can be constructed from an int, otherwise T()
+// (e.g. for ListFile, which would otherwise get a null string)
+template<class T> inline T CmdLine_value_for_missing_option(std::true_type)  {return T(0);}
+template<class T> inline T CmdLine_value_for_missing_option(std::false_type) {return T();}
+template<class T> inline T CmdLine::value_for_missing_option() const {
+  return CmdLine_value_for_missing_option<T>(std::is_constructible<T,int>());
+}
+template<> inline std::string CmdLine::value_for_missing_option<std::string>() const {return "";}
+
+
 std::ostream & operator<<(std::ostream & ostr, CmdLine::OptKind optkind);
 
+/// output of the value of a result
+template<class T>
+std::ostream & operator<<(std::ostream & ostr, const CmdLine::Result<T> & result);
 
-/// default conversion to string, using an istringstream
-/// NB: this is outside the class, because some compilers
-/// can't handle-in class specialisations
-template<class T> T CmdLine_string_to_value(const std::string & str) {
-  std::istringstream optstream(str);
-  T result;
-  optstream >> result;
-  if (optstream.fail()) {throw CmdLine::ConversionFailure(str);}
-  return result;
-}
+
+/// conversion of strings to values of type T, used by CmdLine_string_to_value<T>
+/// (defined in CmdLine-templates.hh); unlike the function template, it can be
+/// partially specialised for families of types, with Enable as the
+/// usual std::enable_if slot (see CmdLineEnum.hh)
+template<class T, class Enable = void> struct CmdLine_string_converter;
+
+/// conversion of arrays, which maps or reads the file if str is @filename
+template<class T> struct CmdLine_string_converter<CmdLine::MappedArray<T>> {
+  static CmdLine::MappedArray<T> convert(const std::string & str) {return CmdLine::MappedArray<T>(str);}
+};
 
 /// specialisation for strings, which just returns the string
 template<> std::string CmdLine_string_to_value<std::string>(const std::string & str);
+
+/// specialisation for list files, which maps the file if str is @filename
+template<> CmdLine::ListFile CmdLine_string_to_value<CmdLine::ListFile>(const std::string & str);
+
+/// specialisations for floating-point types, which return the shortest
+/// string that converts back to exactly the same value
+template<> std::string CmdLine_value_to_string<float>(const float & value);
+template<> std::string CmdLine_value_to_string<double>(const double & value);
+template<> std::string CmdLine_value_to_string<long double>(const long double & value);
+/// specialisations for integer types, which avoid the ostringstream overheads
+template<> std::string CmdLine_value_to_string<int>(const int & value);
+template<> std::string CmdLine_value_to_string<unsigned int>(const unsigned int & value);
+template<> std::string CmdLine_value_to_string<long>(const long & value);
+template<> std::string CmdLine_value_to_string<unsigned long>(const unsigned long & value);
+template<> std::string CmdLine_value_to_string<long long>(const long long & value);
+template<> std::string CmdLine_value_to_string<unsigned long long>(const unsigned long long & value);
+/// specialisation for strings, which just returns the string
+template<> std::string CmdLine_value_to_string<std::string>(const std::string & value);
 /// specialisation for bools, to allow for 0/1, yes/no, on/off, true/false .true./.false.
 template<> bool CmdLine_string_to_value<bool>(const std::string & str);
 
+/// specialisations of the non-throwing conversion for the common types,
+/// which accept the same strings as CmdLine_string_to_value, but use
+/// the C library conversions rather than exceptions and istringstream
+template<> bool CmdLine_try_string_to_value<int>(const std::string & str, int & value);
+template<> bool CmdLine_try_string_to_value<unsigned int>(const std::string & str, unsigned int & value);
+template<> bool CmdLine_try_string_to_value<long>(const std::string & str, long & value);
+template<> bool CmdLine_try_string_to_value<unsigned long>(const std::string & str, unsigned long & value);
+template<> bool CmdLine_try_string_to_value<long long>(const std::string & str, long long & value);
+template<> bool CmdLine_try_string_to_value<unsigned long long>(const std::string & str, unsigned long long & value);
+template<> bool CmdLine_try_string_to_value<float>(const std::string & str, float & value);
+template<> bool CmdLine_try_string_to_value<double>(const std::string & str, double & value);
+template<> bool CmdLine_try_string_to_value<bool>(const std::string & str, bool & value);
+template<> bool CmdLine_try_string_to_value<std::string>(const std::string & str, std::string & value);
+
+
+/// a terminal control code, cf. CmdLine::tc
+class CmdLine::TerminalCode {
+public:
+  constexpr TerminalCode(const char * sequence) : _sequence(sequence) {}
+  /// the escape sequence itself, regardless of whether colour is enabled
+  constexpr const char * sequence() const {return _sequence;}
+  /// the escape sequence if colour is enabled for std::cout, otherwise ""
+  const char * c_str() const;
+  /// conversion to std::string, which gives c_str()
+  operator std::string() const {return c_str();}
+private:
+  const char * _sequence;
+};
 
-template<class T> T CmdLine::internal_value(const std::vector<std::string> & opts, const std::string & prefix) const {
-  std::string optstring = prefix+internal_string_val(opts);
-  std::istringstream optstream(optstring);
-  try {
-    return CmdLine_string_to_value<T>(optstring);
-  } catch (const ConversionFailure & failure) {
-    std::string opt = __arguments[internal_present(opts).first];
-    _report_conversion_failure(opt, failure.what(), typeid(T).name());
-  }
-}
-
+/// Terminal control codes, e.g. `std::cout << CmdLine::tc::red << "text"
+/// << CmdLine::tc::reset`. The codes are constexpr, so they cost nothing
+/// at program start-up. When written to a stream, they are emitted only
+/// if colour is enabled for that stream: by default (mode automatic) this
+/// is the case for std::cout and std::cerr/std::clog if the corresponding
+/// file descriptor is a terminal, the NO_COLOR environment variable is
+/// unset or empty and TERM is not "dumb"; the environment is examined
+/// once per process, on first use. Other streams, e.g. files or string
+/// streams, get the codes only in mode always.
 struct CmdLine::tc {
-  //tc();
-  //bool enabled;
-
-  static std::string red;// = "\033[1;31m";
-  static std::string grn;
-  static std::string yel;
-  static std::string blu;
-  static std::string mag;
-  static std::string cyn;
-  static std::string wht;
-  static std::string blk;
-  static std::string gry;
-  static std::string org;
-
-  static std::string red_bg;
-  static std::string grn_bg;
-  static std::string yel_bg;
-  static std::string blu_bg;
-  static std::string mag_bg;
-  static std::string cyn_bg;
-  static std::string wht_bg;
-  static std::string blk_bg;
-  static std::string gry_bg;
-  static std::string org_bg;
+  /// a single terminal control code
+  using code = TerminalCode;
+
+  /// whether the codes are written: automatic, as described above, or
+  /// always or never
+  enum mode {automatic, always, never};
+  /// set the mode (the default is automatic)
+  static void set_mode(mode m);
+  /// returns true if colour is enabled for std::cout
+  static bool enabled();
+  /// returns true if colour is enabled for the given stream
+  static bool enabled(const std::ostream & ostr);
+
+  static constexpr code red{"\033[31m"};
+  static constexpr code grn{"\033[32m"};
+  static constexpr code yel{"\033[33m"};
+  static constexpr code blu{"\033[34m"};
+  static constexpr code mag{"\033[35m"};
+  static constexpr code cyn{"\033[36m"};
+  static constexpr code wht{"\033[37m"};
+  static constexpr code blk{"\033[30m"};
+  static constexpr code gry{"\033[90m"};
+  static constexpr code org{"\033[91m"};
+
+  static constexpr code red_bg{"\033[41m"};
+  static constexpr code grn_bg{"\033[42m"};
+  static constexpr code yel_bg{"\033[43m"};
+  static constexpr code blu_bg{"\033[44m"};
+  static constexpr code mag_bg{"\033[45m"};
+  static constexpr code cyn_bg{"\033[46m"};
+  static constexpr code wht_bg{"\033[47m"};
+  static constexpr code blk_bg{"\033[40m"};
+  static constexpr code gry_bg{"\033[100m"};
+  static constexpr code org_bg{"\033[101m"};
 
   // versions with full names for those colors that have >3 letters
   // both foreground and background
-  static std::string yellow;
-  static std::string blue;
-  static std::string magenta;
-  static std::string cyan;
-  static std::string white;
-  static std::string black;
-  static std::string gray;
-  static std::string grey;
-  static std::string orange;
-
-  static std::string yellow_bg;
-  static std::string blue_bg;
-  static std::string magenta_bg;
-  static std::string cyan_bg;
-  static std::string white_bg;
-  static std::string black_bg;
-  static std::string gray_bg;
-  static std::string grey_bg;
-  static std::string orange_bg;
-
-
-  static std::string bold;
-  static std::string nobold;
-  static std::string italics;
-  static std::string underline;
-  static std::string reverse;
-  static std::string reset;
-  static std::string clear; ///< clears the screen and moves cursor to home position
-  static std::string clear_screen;
-  static std::string clear_line;
+  static constexpr code yellow {"\033[33m"};
+  static constexpr code blue   {"\033[34m"};
+  static constexpr code magenta{"\033[35m"};
+  static constexpr code cyan   {"\033[36m"};
+  static constexpr code white  {"\033[37m"};
+  static constexpr code black  {"\033[30m"};
+  static constexpr code gray   {"\033[90m"};
+  static constexpr code grey   {"\033[90m"};
+  static constexpr code orange {"\033[91m"};
+
+  static constexpr code yellow_bg {"\033[43m"};
+  static constexpr code blue_bg   {"\033[44m"};
+  static constexpr code magenta_bg{"\033[45m"};
+  static constexpr code cyan_bg   {"\033[46m"};
+  static constexpr code white_bg  {"\033[47m"};
+  static constexpr code black_bg  {"\033[40m"};
+  static constexpr code gray_bg   {"\033[100m"};
+  static constexpr code grey_bg   {"\033[100m"};
+  static constexpr code orange_bg {"\033[101m"};
+
+
+  static constexpr code bold{"\033[1m"};
+  static constexpr code nobold{"\033[22m"};
+  static constexpr code italics{"\033[3m"};
+  static constexpr code underline{"\033[4m"};
+  static constexpr code reverse{"\033[7m"};
+  static constexpr code reset{"\033[0m"};
+  static constexpr code clear{"\033[2J\033[H"}; ///< clears the screen and moves cursor to home position
+  static constexpr code clear_screen{"\033[2J"};
+  static constexpr code clear_line{"\033[2K\r"};
 
 };
 
+/// writes the code to the stream if colour is enabled for that stream
+std::ostream & operator<<(std::ostream & ostr, const CmdLine::tc::code & code);
+/// concatenation with strings, using code.c_str()
+std::string operator+(const CmdLine::tc::code & code, const std::string & str);
+std::string operator+(const std::string & str, const CmdLine::tc::code & code);
+std::string operator+(const CmdLine::tc::code & code, const char * str);
+std::string operator+(const char * str, const CmdLine::tc::code & code);
+std::string operator+(const CmdLine::tc::code & code1, const CmdLine::tc::code & code2);
+
+// the template definitions, unless only the light header is requested
+#ifndef __CMDLINE_LIGHT_HEADER__
+#include "CmdLine-templates.hh"
+#endif
+
+/// explicit instantiation declarations (EXTERN = extern) or definitions
+/// (EXTERN empty, in CmdLine-instantiations.cc) of the option-value
+/// templates with type T, so that code using these types need not
+/// instantiate the templates itself; the part for options with several
+/// values (value_all, positional) is separate, so that it can be placed
+/// in a separate object file
+#define CMDLINE_INSTANTIATIONS(EXTERN, T) \
+  CMDLINE_INSTANTIATIONS_SINGLE(EXTERN, T) \
+  CMDLINE_INSTANTIATIONS_MULTIPLE(EXTERN, T)
+
+#define CMDLINE_INSTANTIATIONS_SINGLE(EXTERN, T) \
+  EXTERN template class CmdLine::Result<T>; \
+  EXTERN template CmdLine::Result<T> CmdLine::any_value<T>(const CmdLine::OptionNames &) const; \
+  EXTERN template CmdLine::Result<T> CmdLine::any_value<T>(const CmdLine::OptionNames &, const T &) const; \
+  EXTERN template CmdLine::Result<T> CmdLine::any_value<T>(const CmdLine::OptionNames &, const T &, \
+                                                           const std::string &) const; \
+  EXTERN template CmdLine::Result<T> CmdLine::any_value_prefix<T>(const CmdLine::OptionNames &, \
+                                                                  const std::string &) const; \
+  EXTERN template CmdLine::Result<T> CmdLine::any_optional_value<T>(const CmdLine::OptionNames &) const; \
+  EXTERN template CmdLine::Expected<T> CmdLine::try_value<T>(CmdLine::OptionName) const; \
+  EXTERN template CmdLine::Expected<T> CmdLine::try_value<T>(CmdLine::OptionName, const T &) const; \
+  EXTERN template CmdLine::Result<T> CmdLine::reuse_value<T>(CmdLine::OptionName) const; \
+  EXTERN template T CmdLine::internal_value<T>(const CmdLine::OptionNames &, const std::string &) const; \
+  EXTERN template std::vector<std::string> CmdLine_values_to_strings<T>(const T &); \
+  EXTERN template std::string CmdLine_value_annotation<T>(const T &); \
+  EXTERN template std::ostream & operator<< <T>(std::ostream &, const CmdLine::Result<T> &);
+
+#define CMDLINE_INSTANTIATIONS_MULTIPLE(EXTERN, T) \
+  EXTERN template class CmdLine::Result<std::vector<T>>; \
+  EXTERN template CmdLine::Result<std::vector<T>> CmdLine::any_value_all<T>(const CmdLine::OptionNames &) const; \
+  EXTERN template CmdLine::Result<std::vector<T>> CmdLine::positional<T>(const std::string &, unsigned, unsigned) const; \
+  EXTERN template std::string CmdLine_value_to_string<T>(const std::vector<T> &); \
+  EXTERN template std::vector<std::string> CmdLine_values_to_strings<T>(const std::vector<T> &); \
+  EXTERN template std::string CmdLine_value_annotation<std::vector<T>>(const std::vector<T> &);
+
+CMDLINE_INSTANTIATIONS(extern, int)
+CMDLINE_INSTANTIATIONS(extern, unsigned)
+CMDLINE_INSTANTIATIONS(extern, int64_t)
+CMDLINE_INSTANTIATIONS(extern, uint64_t)
+CMDLINE_INSTANTIATIONS(extern, double)
+CMDLINE_INSTANTIATIONS(extern, float)
+CMDLINE_INSTANTIATIONS(extern, bool)
+CMDLINE_INSTANTIATIONS(extern, std::string)
+// conversions that are not explicitly specialised for these types
+extern template int      CmdLine_string_to_value<int>     (const std::string &);
+extern template unsigned CmdLine_string_to_value<unsigned>(const std::string &);
+extern template int64_t  CmdLine_string_to_value<int64_t> (const std::string &);
+extern template uint64_t CmdLine_string_to_value<uint64_t>(const std::string &);
+extern template double   CmdLine_string_to_value<double>  (const std::string &);
+extern template float    CmdLine_string_to_value<float>   (const std::string &);
+extern template std::string CmdLine_value_to_string<bool>(const bool &);
+
 #endif
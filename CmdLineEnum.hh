@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// File: CmdLineEnum.hh                                                      //
+// Part of the CmdLine library                                               //
+//                                                                           //
+// Copyright (c) 2007-2023 Gavin Salam with contributions from               //
+// Gregory Soyez and Rob Verheyen                                            //
+//                                                                           //
+// This program is free software; you can redistribute it and/or modify      //
+// it under the terms of the GNU General Public License as published by      //
+// the Free Software Foundation; either version 2 of the License, or         //
+// (at your option) any later version.                                       //
+//                                                                           //
+// This program is distributed in the hope that it will be useful,           //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of            //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             //
+// GNU General Public License for more details.                              //
+//                                                                           //
+// You should have received a copy of the GNU General Public License         //
+// along with this program; if not, write to the Free Software               //
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+// Input and output of enums by name, e.g.
+//
+//   #define PROCESSES(X) X(qq) X(qg) X(gg = 5)
+//   CMDLINE_ENUM(Process, PROCESSES)
+//
+// declares `enum class Process {qq, qg, gg = 5};` together with a table
+// of its names, built at compile time, which is used by operator<< and
+// operator>> for Process, by cmdline.value<Process>("-proc") and to list
+// the valid names as the option's choices in the help. For an existing
+// enum (scoped or not), CMDLINE_ENUM_IO(Enum, LIST) adds only the table
+// and the operators. Both should be used at namespace scope.
+//
+// Names are looked up in a hash table (also built at compile time), so
+// parsing takes a time independent of the number of names.
+
+#ifndef __CMDLINE_ENUM__
+#define __CMDLINE_ENUM__
+
+#include "CmdLine.hh"
+#include<string>
+#include<vector>
+#include<istream>
+#include<ostream>
+#include<cstddef>
+#include<cstdint>
+#include<type_traits>
+
+/// a name and the corresponding value of an enum
+template<class E> struct CmdLineEnumEntry {
+  const char * name = nullptr;
+  size_t length = 0;
+  E value = E();
+};
+
+/// the length of the enumerator name in an entry of a CMDLINE_ENUM list,
+/// i.e. up to any whitespace or "=" (as in "gg = 5")
+constexpr size_t CmdLineEnum_name_length(const char * str) {
+  size_t length = 0;
+  while (str[length] != '\0' && str[length] != ' ' && str[length] != '='
+         && str[length] != '\t' && str[length] != '\n') length++;
+  return length;
+}
+
+/// the size of the hash tables for n names: a power of two, at least 2n
+constexpr size_t CmdLineEnum_table_size(size_t n) {
+  size_t size = 2;
+  while (size < 2 * n) size *= 2;
+  return size;
+}
+
+/// 64-bit FNV-1a hash of n characters
+constexpr uint64_t CmdLineEnum_hash(const char * str, size_t n) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < n; i++) {
+    hash ^= uint64_t(static_cast<unsigned char>(str[i]));
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/// converts to E from the result of "(CmdLineEnum_ignore_assign<E>) E::gg = 5",
+/// which is how the value of each enumerator is obtained from the list
+template<class E> struct CmdLineEnum_ignore_assign {
+  constexpr CmdLineEnum_ignore_assign(E value_in) : value(value_in) {}
+  template<class U> constexpr CmdLineEnum_ignore_assign operator=(const U &) const {return *this;}
+  constexpr operator E() const {return value;}
+  E value;
+};
+
+/// table of the N names of enum E and their values, with hash tables
+/// from names to entries and from values to entries, built at compile time
+template<class E, size_t N> class CmdLineEnumTable {
+public:
+  typedef CmdLineEnumEntry<E> Entry;
+
+  constexpr CmdLineEnumTable(const Entry (&entries)[N]) : _entries{}, _by_name{}, _by_value{} {
+    for (size_t i = 0; i < N; i++) {
+      _entries[i] = entries[i];
+      _entries[i].length = CmdLineEnum_name_length(entries[i].name);
+      size_t h = _name_slot(_entries[i].name, _entries[i].length);
+      // a repeated name is a compile-time error (the throw cannot be evaluated)
+      if (_by_name[h] != 0) throw "CMDLINE_ENUM: repeated name";
+      _by_name[h] = uint32_t(i + 1);
+      // values with several names are written with the first one
+      h = _value_slot(entries[i].value);
+      if (_by_value[h] == 0) _by_value[h] = uint32_t(i + 1);
+    }
+  }
+
+  static constexpr size_t size() {return N;}
+  const Entry * begin() const {return _entries;}
+  const Entry * end()   const {return _entries + N;}
+
+  /// sets value and returns true if name (of the given length) is one of
+  /// the names, otherwise returns false
+  bool find(const char * name, size_t length, E & value) const {
+    const uint32_t index = _by_name[_name_slot(name, length)];
+    if (index == 0) return false;
+    value = _entries[index-1].value;
+    return true;
+  }
+
+  /// returns the (first) name for value, or nullptr if it has none
+  const Entry * entry(E value) const {
+    const uint32_t index = _by_value[_value_slot(value)];
+    return index == 0 ? nullptr : &_entries[index-1];
+  }
+
+private:
+  static constexpr size_t _mask = CmdLineEnum_table_size(N) - 1;
+
+  static constexpr bool _same_name(const Entry & entry, const char * name, size_t length) {
+    if (entry.length != length) return false;
+    for (size_t i = 0; i < length; i++) if (entry.name[i] != name[i]) return false;
+    return true;
+  }
+  /// the slot of the name, or the empty slot where it would go
+  constexpr size_t _name_slot(const char * name, size_t length) const {
+    size_t h = size_t(CmdLineEnum_hash(name, length)) & _mask;
+    while (_by_name[h] != 0 && !_same_name(_entries[_by_name[h]-1], name, length)) h = (h + 1) & _mask;
+    return h;
+  }
+  /// the slot of the value, or the empty slot where it would go
+  constexpr size_t _value_slot(E value) const {
+    size_t h = size_t((uint64_t(value) * 0x9e3779b97f4a7c15ULL) >> 32) & _mask;
+    while (_by_value[h] != 0 && _entries[_by_value[h]-1].value != value) h = (h + 1) & _mask;
+    return h;
+  }
+
+  Entry _entries[N];
+  uint32_t _by_name[_mask + 1];
+  uint32_t _by_value[_mask + 1];
+};
+
+/// true if E has a table of names, declared with CMDLINE_ENUM or CMDLINE_ENUM_IO
+template<class E, class Enable = void> struct CmdLineEnum_has_table : std::false_type {};
+template<class E> struct CmdLineEnum_has_table<E, decltype(void(CmdLine_enum_table(E())))>
+  : std::true_type {};
+
+/// writes the name of value (or its number, if it has no name)
+template<class E> std::ostream & CmdLineEnum_write(std::ostream & ostr, E value) {
+  auto entry = CmdLine_enum_table(value).entry(value);
+  if (entry) ostr.write(entry->name, std::streamsize(entry->length));
+  else       ostr << static_cast<typename std::underlying_type<E>::type>(value);
+  return ostr;
+}
+
+/// reads a name, and sets the failbit if it is not one of the names of E
+template<class E> std::istream & CmdLineEnum_read(std::istream & istr, E & value) {
+  std::string name;
+  if (istr >> name && !CmdLine_enum_table(value).find(name.data(), name.size(), value)) {
+    istr.setstate(std::ios::failbit);
+  }
+  return istr;
+}
+
+/// conversion of option values to enums with a table of names
+template<class E> struct CmdLine_string_converter<E, typename std::enable_if<CmdLineEnum_has_table<E>::value>::type> {
+  static E convert(const std::string & str) {
+    E value = E();
+    if (!CmdLine_enum_table(value).find(str.data(), str.size(), value)) throw CmdLine::ConversionFailure(str);
+    return value;
+  }
+};
+
+/// the names of enums with a table, listed as the choices of their options
+template<class E> struct CmdLine_value_names<E, typename std::enable_if<CmdLineEnum_has_table<E>::value>::type> {
+  static std::vector<std::string> names() {
+    std::vector<std::string> result;
+    for (const auto & entry: CmdLine_enum_table(E())) result.emplace_back(entry.name, entry.length);
+    return result;
+  }
+};
+
+// the entries of the LIST(X) macro given to CMDLINE_ENUM, each of the
+// form X(name) or X(name = value)
+#define CMDLINE_ENUM_DECLARATION_(entry) entry,
+#define CMDLINE_ENUM_ENTRY_(entry) \
+  {#entry, 0, (CmdLineEnum_ignore_assign<CmdLineEnum_type>) CmdLineEnum_type::entry},
+
+/// declares the enum class Name, with the enumerators in LIST, together
+/// with its table of names and I/O operators
+#define CMDLINE_ENUM(Name, LIST)                                              \
+  enum class Name {LIST(CMDLINE_ENUM_DECLARATION_)};                          \
+  CMDLINE_ENUM_IO(Name, LIST)
+
+/// declares the table of names and the I/O operators for an existing
+/// enum Name, whose enumerators are given in LIST
+#define CMDLINE_ENUM_IO(Name, LIST)                                           \
+  inline const auto & CmdLine_enum_table(Name) {                              \
+    typedef Name CmdLineEnum_type;                                            \
+    static constexpr CmdLineEnumEntry<Name> entries[] = {LIST(CMDLINE_ENUM_ENTRY_)}; \
+    static constexpr CmdLineEnumTable<Name, sizeof(entries)/sizeof(entries[0])> table(entries); \
+    return table;                                                             \
+  }                                                                           \
+  inline std::ostream & operator<<(std::ostream & ostr, Name value) {         \
+    return CmdLineEnum_write(ostr, value);                                    \
+  }                                                                           \
+  inline std::istream & operator>>(std::istream & istr, Name & value) {       \
+    return CmdLineEnum_read(istr, value);                                     \
+  }
+
+#endif // __CMDLINE_ENUM__
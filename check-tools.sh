@@ -0,0 +1,88 @@
+#!/bin/sh
+#
+# Checks the cmdline-catalog and cmdline-validate programs on the
+# outputs and options of the example program; run from the build
+# directory by "make check".
+
+dir=check-tools.tmp
+rm -rf $dir
+mkdir $dir || exit 1
+status=0
+
+# compares the output of a command with the expected one
+expect() {
+  expected="$1"
+  shift
+  result=`"$@" 2>&1`
+  if [ "$result" != "$expected" ]; then
+    echo "check-tools.sh failure from: $*" >&2
+    echo "  Expected: $expected" >&2
+    echo "  Got:      $result" >&2
+    status=1
+  fi
+}
+
+#----------------------------------------------------------------------
+# cmdline-catalog: index some outputs, then rewrite one and delete another
+./example -i 0 -f 0 --dump > $dir/run0.out
+./example -i 1      --dump > $dir/run1.out
+./example -i 2      --dump > $dir/run2.out
+catalog="./cmdline-catalog -index $dir/runs.idx"
+expect ""                   $catalog update $dir/run0.out $dir/run1.out $dir/run2.out
+expect "$dir/run1.out"      $catalog query -where -i=1
+expect "$dir/run1.out
+$dir/run2.out"              $catalog query -where -i=1:2 -where -f=1
+expect "0 1
+1 1
+2 1"                        $catalog values -option -i
+
+./example -i 2 -f 0 --dump > $dir/run1.out
+rm $dir/run2.out
+expect ""                   $catalog update -prune $dir/run1.out
+expect "2"                  $catalog query -count
+expect "$dir/run1.out"      $catalog query -where -i=2
+expect ""                   $catalog query -where -f=1
+expect "0 1
+2 1"                        $catalog values -option -i
+expect "0 2"                $catalog values -option -f
+
+#----------------------------------------------------------------------
+# cmdline-validate: check argfiles against the schema of the example
+./example --cmdline-schema > $dir/example.schema
+printf -- "-i 1\n-f\n"      > $dir/good1.arg
+printf -- "-i 2 -no-f\n"    > $dir/good2.arg
+printf -- "-i 3\n"          > $dir/bad1.arg
+printf -- "-i 1 -f 0 -x\n"  > $dir/bad2.arg
+printf -- "-f 0\n"          > $dir/bad3.arg
+validate="./cmdline-validate -schema $dir/example.schema"
+expect "# checked 2 argfiles against the options of ./example: 0 invalid" \
+                            $validate -j 2 $dir/good1.arg $dir/good2.arg
+expect "$dir/bad1.arg: value 3 of option -i is not one of the choices {0, 1, 2}
+$dir/bad2.arg: unknown option -x
+$dir/bad3.arg: required option -i is missing
+$dir/good1.arg: OK
+$dir/good2.arg: OK
+# checked 5 argfiles against the options of ./example: 3 invalid" \
+                            $validate -j 2 -v $dir/bad1.arg $dir/bad2.arg $dir/bad3.arg $dir/good1.arg $dir/good2.arg
+# every point of a sweep is checked, each problem being reported once
+printf -- "-i {0,1,2}\n-d 0:2:0.5\n"  > $dir/sweep-good.arg
+printf -- "-i 0:4:1\n-d {1,3}\n"      > $dir/sweep-bad.arg
+expect "$dir/sweep-bad.arg: value 3 of option -d is outside the range -1 to 2 (sweep point 1 of 10)
+$dir/sweep-bad.arg: value 3 of option -i is not one of the choices {0, 1, 2} (sweep point 6 of 10)
+$dir/sweep-bad.arg: value 4 of option -i is not one of the choices {0, 1, 2} (sweep point 8 of 10)
+$dir/sweep-good.arg: OK
+# checked 2 argfiles against the options of ./example: 1 invalid" \
+                            $validate -j 2 -v $dir/sweep-bad.arg $dir/sweep-good.arg
+if $validate $dir/bad1.arg > /dev/null 2>&1; then
+  echo "check-tools.sh failure: cmdline-validate accepted an invalid argfile" >&2
+  status=1
+fi
+# without "optional_value", -f is an ordinary value<bool>, which needs its value
+sed 's/, "optional_value": true//' $dir/example.schema > $dir/value-bool.schema
+expect "$dir/good1.arg: option -f is missing its value
+$dir/good2.arg: unknown option -no-f
+# checked 2 argfiles against the options of ./example: 2 invalid" \
+                            ./cmdline-validate -schema $dir/value-bool.schema $dir/good1.arg $dir/good2.arg
+
+rm -rf $dir
+exit $status
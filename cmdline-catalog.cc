@@ -0,0 +1,443 @@
+///////////////////////////////////////////////////////////////////////////////
+// File: cmdline-catalog.cc                                                  //
+// Part of the CmdLine library                                               //
+//                                                                           //
+// Copyright (c) 2007-2019 Gavin Salam                                       //
+//                                                                           //
+// This program is free software; you can redistribute it and/or modify      //
+// it under the terms of the GNU General Public License as published by      //
+// the Free Software Foundation; either version 2 of the License, or         //
+// (at your option) any later version.                                       //
+//                                                                           //
+// This program is distributed in the hope that it will be useful,           //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of            //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             //
+// GNU General Public License for more details.                              //
+//                                                                           //
+// You should have received a copy of the GNU General Public License         //
+// along with this program; if not, write to the Free Software               //
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+//
+// Catalog of the runs of a program, built from the CmdLine::dump() at the
+// top of each run's output, e.g.
+//
+//   cmdline-catalog -index runs.idx update -list @outputs.txt -j 8
+//   cmdline-catalog -index runs.idx query  -where -d=0.5 -where -f -where -n=2:10
+//   cmdline-catalog -index runs.idx values -option -d
+//
+// The index is organised by column: for each option, the list of runs
+// that have each of its values.
+
+#include "CmdLine.hh"
+#include<iostream>
+#include<fstream>
+#include<algorithm>
+#include<atomic>
+#include<thread>
+#include<unordered_map>
+#include<cstdlib>
+#include<cstring>
+#include<cmath>
+#include<sys/stat.h>
+
+using namespace std;
+
+/// a run, i.e. an output file, in the catalog
+struct Run {
+  string file;          ///< empty for a run that has been removed
+  int64_t mtime_ns = 0; ///< modification time and size when indexed
+  int64_t size = 0;
+};
+
+/// the runs, and for each option the (sorted) list of runs that have
+/// each of its values
+class Catalog {
+public:
+  vector<Run> runs;
+  map<string, map<string, vector<uint32_t>>> columns;
+
+  void read(const string & filename);
+  void write(const string & filename);
+  /// removes the given runs from the columns (but not from runs)
+  void remove_from_columns(const vector<bool> & removed);
+
+private:
+  static const char magic[9];
+};
+const char Catalog::magic[9] = "CMDLCAT1";
+
+namespace {
+  void write_u64(ostream & out, uint64_t n) {out.write(reinterpret_cast<const char *>(&n), sizeof(n));}
+  void write_string(ostream & out, const string & str) {
+    write_u64(out, str.size());
+    out.write(str.data(), str.size());
+  }
+
+  /// sequential reader of the index file content
+  class Reader {
+  public:
+    Reader(const string & buffer, const string & filename) :
+      _pos(buffer.data()), _end(buffer.data() + buffer.size()), _filename(filename) {}
+    uint64_t u64() {
+      uint64_t n;
+      memcpy(&n, take(sizeof(n)), sizeof(n));
+      return n;
+    }
+    string str() {
+      size_t n = u64();
+      return string(take(n), n);
+    }
+    void ids(vector<uint32_t> & result) {
+      size_t n = u64();
+      result.resize(n);
+      if (n) memcpy(result.data(), take(n * sizeof(uint32_t)), n * sizeof(uint32_t));
+    }
+    const char * take(size_t n) {
+      if (size_t(_end - _pos) < n) throw CmdLine::Error("index file " + _filename + " is truncated");
+      const char * result = _pos;
+      _pos += n;
+      return result;
+    }
+  private:
+    const char * _pos, * _end;
+    string _filename;
+  };
+
+  /// returns the modification time (in ns) and size of the file, or false
+  /// if it does not exist
+  bool file_status(const string & filename, int64_t & mtime_ns, int64_t & size) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) return false;
+#ifdef __APPLE__
+    mtime_ns = int64_t(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    mtime_ns = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    size = info.st_size;
+    return true;
+  }
+
+  /// returns true if str is a number, setting x to its value
+  bool numeric(const string & str, double & x) {
+    if (str.size() == 0) return false;
+    char * end;
+    x = strtod(str.c_str(), &end);
+    return *end == '\0';
+  }
+}
+
+void Catalog::read(const string & filename) {
+  ifstream in(filename, ios::binary);
+  if (!in.good()) throw CmdLine::Error("could not open index file " + filename);
+  string buffer((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  Reader reader(buffer, filename);
+  if (memcmp(reader.take(8), magic, 8) != 0) throw CmdLine::Error(filename + " is not a catalog index file");
+  runs.resize(reader.u64());
+  for (auto & run: runs) {
+    run.file = reader.str();
+    run.mtime_ns = int64_t(reader.u64());
+    run.size     = int64_t(reader.u64());
+  }
+  columns.clear();
+  for (size_t n_options = reader.u64(); n_options > 0; n_options--) {
+    auto & column = columns[reader.str()];
+    for (size_t n_values = reader.u64(); n_values > 0; n_values--) {
+      reader.ids(column[reader.str()]);
+    }
+  }
+}
+
+void Catalog::write(const string & filename) {
+  // renumber the runs to leave out removed ones
+  vector<uint32_t> new_id(runs.size());
+  size_t n_kept = 0;
+  for (size_t i = 0; i < runs.size(); i++) {
+    if (runs[i].file.size() == 0) continue;
+    new_id[i] = uint32_t(n_kept);
+    if (n_kept != i) runs[n_kept] = std::move(runs[i]);
+    n_kept++;
+  }
+  runs.resize(n_kept);
+  for (auto & column: columns) {
+    for (auto & value: column.second) {
+      for (auto & id: value.second) id = new_id[id];
+    }
+  }
+
+  // write to a temporary file, which then replaces the index, so that
+  // queries never see a partially written index
+  string tmp_filename = filename + ".tmp";
+  {
+    ofstream out(tmp_filename, ios::binary);
+    if (!out.good()) throw CmdLine::Error("could not open " + tmp_filename + " for writing");
+    out.write(magic, 8);
+    write_u64(out, runs.size());
+    for (const auto & run: runs) {
+      write_string(out, run.file);
+      write_u64(out, uint64_t(run.mtime_ns));
+      write_u64(out, uint64_t(run.size));
+    }
+    write_u64(out, columns.size());
+    for (const auto & column: columns) {
+      write_string(out, column.first);
+      write_u64(out, column.second.size());
+      for (const auto & value: column.second) {
+        write_string(out, value.first);
+        write_u64(out, value.second.size());
+        out.write(reinterpret_cast<const char *>(value.second.data()), value.second.size() * sizeof(uint32_t));
+      }
+    }
+    if (!out.good()) throw CmdLine::Error("could not write " + tmp_filename);
+  }
+  if (rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    throw CmdLine::Error("could not rename " + tmp_filename + " to " + filename);
+  }
+}
+
+void Catalog::remove_from_columns(const vector<bool> & removed) {
+  for (auto column = columns.begin(); column != columns.end(); ) {
+    for (auto value = column->second.begin(); value != column->second.end(); ) {
+      auto & ids = value->second;
+      ids.erase(remove_if(ids.begin(), ids.end(), [&](uint32_t id){return removed[id];}), ids.end());
+      value = ids.size() == 0 ? column->second.erase(value) : std::next(value);
+    }
+    column = column->second.size() == 0 ? columns.erase(column) : std::next(column);
+  }
+}
+
+//----------------------------------------------------------------------
+/// adds new runs to the catalog, and reindexes runs whose output has changed
+void update(const string & index, const vector<string> & files, const string & prefix,
+            unsigned n_threads, bool prune, bool verbose) {
+  Catalog catalog;
+  int64_t dummy_mtime, dummy_size;
+  if (file_status(index, dummy_mtime, dummy_size)) catalog.read(index);
+  unordered_map<string, uint32_t> run_ids;
+  for (uint32_t id = 0; id < catalog.runs.size(); id++) run_ids[catalog.runs[id].file] = id;
+
+  // decide which files need to be (re)scanned, and which runs have gone
+  vector<bool> removed(catalog.runs.size(), false);
+  vector<uint32_t> to_scan;
+  size_t n_missing = 0;
+  for (const auto & file: files) {
+    Run run;
+    run.file = file;
+    bool exists = file_status(file, run.mtime_ns, run.size);
+    auto existing = run_ids.find(file);
+    if (existing == run_ids.end()) {
+      if (!exists) {n_missing++; continue;}
+      run_ids[file] = uint32_t(catalog.runs.size());
+      to_scan.push_back(uint32_t(catalog.runs.size()));
+      catalog.runs.push_back(run);
+      removed.push_back(false);
+    } else {
+      Run & old_run = catalog.runs[existing->second];
+      if (!exists) {
+        n_missing++;
+        removed[existing->second] = true;
+        old_run.file.clear();
+      } else if (old_run.mtime_ns != run.mtime_ns || old_run.size != run.size) {
+        removed[existing->second] = true;
+        to_scan.push_back(existing->second);
+        old_run = run;
+      }
+    }
+  }
+  if (prune) {
+    for (uint32_t id = 0; id < catalog.runs.size(); id++) {
+      Run & run = catalog.runs[id];
+      if (run.file.size() != 0 && !file_status(run.file, dummy_mtime, dummy_size)) {
+        removed[id] = true;
+        run.file.clear();
+      }
+    }
+  }
+  catalog.remove_from_columns(removed);
+
+  // read the dumps in parallel
+  vector<vector<pair<string,string>>> entries(to_scan.size());
+  atomic<size_t> next_scan{0};
+  auto scan = [&]() {
+    for (size_t i = next_scan++; i < to_scan.size(); i = next_scan++) {
+      ifstream in(catalog.runs[to_scan[i]].file);
+      entries[i] = CmdLine::read_dump(in, prefix);
+    }
+  };
+  vector<thread> threads;
+  for (unsigned i = 1; i < n_threads; i++) threads.emplace_back(scan);
+  scan();
+  for (auto & thread: threads) thread.join();
+
+  // and add them to the columns
+  size_t n_without_dump = 0;
+  for (size_t i = 0; i < to_scan.size(); i++) {
+    if (entries[i].size() == 0) n_without_dump++;
+    for (const auto & entry: entries[i]) {
+      vector<uint32_t> & ids = catalog.columns[entry.first][entry.second];
+      // an option may occur several times with the same value
+      if (ids.size() == 0 || ids.back() != to_scan[i]) ids.push_back(to_scan[i]);
+    }
+  }
+  // reindexed runs keep their number, so their lists may need sorting
+  for (auto & column: catalog.columns) {
+    for (auto & value: column.second) {
+      if (!is_sorted(value.second.begin(), value.second.end())) {
+        sort(value.second.begin(), value.second.end());
+        value.second.erase(unique(value.second.begin(), value.second.end()), value.second.end());
+      }
+    }
+  }
+  catalog.write(index);
+
+  if (verbose) {
+    cerr << "# indexed " << to_scan.size() << " new or changed runs (" << n_without_dump
+         << " without a dump), " << n_missing << " missing; " << catalog.runs.size()
+         << " runs in " << index << endl;
+  }
+}
+
+//----------------------------------------------------------------------
+/// a condition on an option: -opt (present), -opt=value or -opt=min:max
+class Condition {
+public:
+  Condition(const string & condition) {
+    size_t equals = condition.find('=');
+    option = condition.substr(0, equals);
+    if (equals == string::npos) return;
+    kind = equal;
+    value = condition.substr(equals + 1);
+    _numeric = numeric(value, _x);
+    size_t colon = value.find(':');
+    if (colon != string::npos) {
+      string min = value.substr(0, colon), max = value.substr(colon + 1);
+      bool min_ok = min.size() == 0 || numeric(min, _min);
+      bool max_ok = max.size() == 0 || numeric(max, _max);
+      if (min_ok && max_ok && min.size() + max.size() != 0) {
+        kind = range;
+        if (min.size() == 0) _min = -HUGE_VAL;
+        if (max.size() == 0) _max =  HUGE_VAL;
+      }
+    }
+  }
+
+  /// true if the value of the option satisfies the condition
+  bool matches(const string & option_value) const {
+    double x;
+    switch (kind) {
+    case present: return true;
+    case equal:   return option_value == value || (_numeric && numeric(option_value, x) && x == _x);
+    case range:   return numeric(option_value, x) && x >= _min && x <= _max;
+    }
+    return false;
+  }
+
+  /// the sorted runs that satisfy the condition
+  vector<uint32_t> runs(const Catalog & catalog) const {
+    vector<uint32_t> result;
+    auto column = catalog.columns.find(option);
+    if (column == catalog.columns.end()) return result;
+    if (kind == equal && !_numeric) {
+      auto ids = column->second.find(value);
+      if (ids != column->second.end()) result = ids->second;
+      return result;
+    }
+    for (const auto & ids: column->second) {
+      if (matches(ids.first)) result.insert(result.end(), ids.second.begin(), ids.second.end());
+    }
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+  enum Kind {present, equal, range};
+  Kind kind = present;
+  string option, value;
+
+private:
+  bool _numeric = false;
+  double _x = 0, _min = 0, _max = 0;
+};
+
+/// prints the runs that satisfy all the conditions
+void query(const string & index, const vector<string> & conditions, bool count_only) {
+  Catalog catalog;
+  catalog.read(index);
+  vector<uint32_t> result(catalog.runs.size());
+  for (uint32_t id = 0; id < result.size(); id++) result[id] = id;
+  for (const auto & condition: conditions) {
+    vector<uint32_t> runs = Condition(condition).runs(catalog), intersection;
+    set_intersection(result.begin(), result.end(), runs.begin(), runs.end(), back_inserter(intersection));
+    result.swap(intersection);
+  }
+  if (count_only) {
+    cout << result.size() << endl;
+  } else {
+    for (auto id: result) cout << catalog.runs[id].file << '\n';
+  }
+}
+
+/// prints the values of an option and the number of runs with each value
+void values(const string & index, const string & option) {
+  Catalog catalog;
+  catalog.read(index);
+  auto column = catalog.columns.find(option);
+  if (column == catalog.columns.end()) return;
+  for (const auto & value: column->second) {
+    cout << value.first << " " << value.second.size() << '\n';
+  }
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char ** argv) {
+  CmdLine cmdline(argc, argv);
+  cmdline.help("Catalog of the runs of a program, indexed by the options in the "
+               "CmdLine::dump() at the top of each run's output.");
+  string index = cmdline.value<string>("-index").argname("filename")
+                        .help("the index file");
+  bool verbose = cmdline.present("-v").help("print information about what was done");
+
+  // options of the subcommands
+  string prefix, option;
+  unsigned n_threads = 1;
+  bool prune = false, count_only = false;
+  vector<string> files, conditions;
+
+  cmdline.subcommand("update", "add runs to the index (or reindex them if their output has changed)",
+                     [&](CmdLine & sub) {
+    prefix = sub.value<string>("-prefix", "# ")
+                .help("the comment prefix with which the dump was written");
+    n_threads = sub.value<unsigned>("-j", std::max(1u, thread::hardware_concurrency()))
+                   .help("number of threads for reading the outputs");
+    prune = sub.present("-prune").help("also remove runs whose output no longer exists");
+    auto list = sub.optional_value<CmdLine::ListFile>("-list").argname("@filename")
+                   .help("a file with the names of the outputs, one per line");
+    files = sub.positional<string>("outputs").help("the outputs to add to the index");
+    if (list.present()) {
+      for (const auto & file: list.value()) files.emplace_back(file);
+    }
+  });
+
+  cmdline.subcommand("query", "print the runs whose options satisfy all the conditions",
+                     [&](CmdLine & sub) {
+    conditions = sub.value_all<string>("-where").argname("condition")
+                    .help("-opt (present), -opt=value or -opt=min:max (a numerical range, "
+                          "where min or max may be omitted)");
+    count_only = sub.present("-count").help("print only the number of runs");
+  });
+
+  cmdline.subcommand("values", "print the values of an option, with the number of runs for each",
+                     [&](CmdLine & sub) {
+    option = sub.value<string>("-option").help("the option");
+  });
+
+  cmdline.assert_all_options_used();
+
+  const string & subcommand = cmdline.subcommand_name();
+  if      (subcommand == "update") update(index, files, prefix, n_threads, prune, verbose);
+  else if (subcommand == "query")  query(index, conditions, count_only);
+  else if (subcommand == "values") values(index, option);
+  else                             cmdline.print_help();
+  if (verbose) cerr << "# time: " << cmdline.time_elapsed_since_start() << " s" << endl;
+}
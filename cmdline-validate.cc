@@ -0,0 +1,475 @@
+///////////////////////////////////////////////////////////////////////////////
+// File: cmdline-validate.cc                                                 //
+// Part of the CmdLine library                                               //
+//                                                                           //
+// Copyright (c) 2007-2019 Gavin Salam                                       //
+//                                                                           //
+// This program is free software; you can redistribute it and/or modify      //
+// it under the terms of the GNU General Public License as published by      //
+// the Free Software Foundation; either version 2 of the License, or         //
+// (at your option) any later version.                                       //
+//                                                                           //
+// This program is distributed in the hope that it will be useful,           //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of            //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             //
+// GNU General Public License for more details.                              //
+//                                                                           //
+// You should have received a copy of the GNU General Public License         //
+// along with this program; if not, write to the Free Software               //
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+//
+// Checks argfiles against the schema of a program's options, without
+// running the program, e.g.
+//
+//   prog --cmdline-schema > prog.schema
+//   cmdline-validate -schema prog.schema -list @argfiles.txt -j 8
+//
+// It reports unknown options, missing or invalid values (type, choices
+// and range), repeated or mutually exclusive options, missing required
+// options and unexpected positional arguments. For an argfile with a
+// parameter sweep, every point of the sweep is checked.
+
+#include "CmdLine.hh"
+#include<iostream>
+#include<fstream>
+#include<sstream>
+#include<algorithm>
+#include<atomic>
+#include<thread>
+#include<unordered_map>
+#include<set>
+#include<memory>
+#include<cstdlib>
+#include<cstring>
+
+using namespace std;
+
+//----------------------------------------------------------------------
+/// a JSON value, with just what is needed to read a schema
+struct Json {
+  enum Type {null, boolean, number, string, array, object} type = null;
+  bool boolean_value = false;
+  double number_value = 0;
+  std::string string_value;
+  vector<Json> array_value;
+  vector<pair<std::string,Json>> object_value;
+
+  /// returns the member with the given name, or a null value
+  const Json & operator[](const std::string & name) const {
+    static const Json none;
+    for (const auto & member: object_value) if (member.first == name) return member.second;
+    return none;
+  }
+  /// returns the strings in an array (an empty vector for a null value)
+  vector<std::string> strings() const {
+    vector<std::string> result;
+    for (const auto & entry: array_value) result.push_back(entry.string_value);
+    return result;
+  }
+};
+
+/// recursive-descent parser for JSON
+class JsonParser {
+public:
+  JsonParser(const std::string & text) : _text(text) {}
+  Json parse() {
+    Json result = _value();
+    _skip_space();
+    if (_pos != _text.size()) _fail("unexpected trailing characters");
+    return result;
+  }
+
+private:
+  void _fail(const std::string & message) const {
+    throw CmdLine::Error("invalid schema (" + message + " at character " + to_string(_pos) + ")");
+  }
+  void _skip_space() {
+    while (_pos < _text.size() && isspace(static_cast<unsigned char>(_text[_pos]))) _pos++;
+  }
+  bool _accept(char c) {
+    _skip_space();
+    if (_pos < _text.size() && _text[_pos] == c) {_pos++; return true;}
+    return false;
+  }
+  void _expect(char c) {if (!_accept(c)) _fail(std::string("expected '") + c + "'");}
+  bool _accept_word(const char * word) {
+    size_t length = strlen(word);
+    if (_text.compare(_pos, length, word) != 0) return false;
+    _pos += length;
+    return true;
+  }
+
+  Json _value() {
+    Json result;
+    _skip_space();
+    if (_pos == _text.size()) _fail("unexpected end");
+    char c = _text[_pos];
+    if (c == '{') {
+      result.type = Json::object;
+      _pos++;
+      if (_accept('}')) return result;
+      do {
+        _skip_space();
+        std::string name = _string();
+        _expect(':');
+        result.object_value.emplace_back(name, _value());
+      } while (_accept(','));
+      _expect('}');
+    } else if (c == '[') {
+      result.type = Json::array;
+      _pos++;
+      if (_accept(']')) return result;
+      do {result.array_value.push_back(_value());} while (_accept(','));
+      _expect(']');
+    } else if (c == '"') {
+      result.type = Json::string;
+      result.string_value = _string();
+    } else if (_accept_word("true")) {
+      result.type = Json::boolean;
+      result.boolean_value = true;
+    } else if (_accept_word("false")) {
+      result.type = Json::boolean;
+    } else if (_accept_word("null")) {
+    } else {
+      char * end;
+      result.type = Json::number;
+      result.number_value = strtod(_text.c_str() + _pos, &end);
+      if (end == _text.c_str() + _pos) _fail("unexpected character");
+      _pos = end - _text.c_str();
+    }
+    return result;
+  }
+
+  std::string _string() {
+    if (_pos == _text.size() || _text[_pos] != '"') _fail("expected a string");
+    std::string result;
+    for (_pos++; _pos < _text.size() && _text[_pos] != '"'; _pos++) {
+      if (_text[_pos] != '\\') {result += _text[_pos]; continue;}
+      if (++_pos == _text.size()) break;
+      switch (_text[_pos]) {
+      case 'n': result += '\n'; break;
+      case 't': result += '\t'; break;
+      case 'r': result += '\r'; break;
+      case 'b': result += '\b'; break;
+      case 'f': result += '\f'; break;
+      case 'u': {
+        // (only code points below 0x80, as written by CmdLine::schema())
+        if (_pos + 4 >= _text.size()) _fail("incomplete \\u escape");
+        result += char(strtol(_text.substr(_pos+1, 4).c_str(), nullptr, 16));
+        _pos += 4;
+        break;
+      }
+      default: result += _text[_pos];
+      }
+    }
+    if (_pos == _text.size()) _fail("unterminated string");
+    _pos++;
+    return result;
+  }
+
+  const std::string & _text;
+  size_t _pos = 0;
+};
+
+//----------------------------------------------------------------------
+/// check of the values of an option: returns an empty string for a
+/// valid value, and otherwise the reason why it is not valid
+class ValueCheck {
+public:
+  virtual ~ValueCheck() {}
+  virtual string check(const string & value) const = 0;
+};
+
+/// check that a value converts to type T, is one of the choices (if
+/// any) and lies in the range (if any)
+template<class T> class TypedCheck : public ValueCheck {
+public:
+  TypedCheck(const string & type_name, const vector<string> & choices, const vector<string> & range)
+    : _type_name(type_name), _choice_list(choices) {
+    for (const auto & choice: choices) _choices.push_back(_convert(choice));
+    if (range.size() == 2) _range = {_convert(range[0]), _convert(range[1])};
+  }
+
+  string check(const string & value) const override {
+    T t;
+    if (!CmdLine_try_string_to_value<T>(value, t)) return "cannot be converted to " + _type_name;
+    if (_choices.size() != 0 && find(_choices.begin(), _choices.end(), t) == _choices.end()) {
+      string message = "is not one of the choices {";
+      for (size_t i = 0; i < _choice_list.size(); i++) message += (i == 0 ? "" : ", ") + _choice_list[i];
+      return message + "}";
+    }
+    if (_range.size() == 2 && (t < _range[0] || _range[1] < t)) {
+      return "is outside the range " + CmdLine_value_to_string(_range[0]) + " to "
+                                     + CmdLine_value_to_string(_range[1]);
+    }
+    return "";
+  }
+
+private:
+  T _convert(const string & str) const {
+    T t;
+    if (!CmdLine_try_string_to_value<T>(str, t)) {
+      throw CmdLine::Error("invalid schema: " + str + " does not convert to " + _type_name);
+    }
+    return t;
+  }
+  string _type_name;
+  vector<string> _choice_list;
+  vector<T> _choices, _range;
+};
+
+/// returns the check for values of the given type (as from
+/// CmdLine::OptionHelp::type_name()); values of unknown types are only
+/// checked against the choices
+unique_ptr<ValueCheck> make_check(const string & type, const vector<string> & choices,
+                                  const vector<string> & range) {
+  if (type == "int")                return unique_ptr<ValueCheck>(new TypedCheck<int>(type, choices, range));
+  if (type == "unsigned int")       return unique_ptr<ValueCheck>(new TypedCheck<unsigned>(type, choices, range));
+  if (type == "long")               return unique_ptr<ValueCheck>(new TypedCheck<long>(type, choices, range));
+  if (type == "unsigned long")      return unique_ptr<ValueCheck>(new TypedCheck<unsigned long>(type, choices, range));
+  if (type == "long long" || type == "int64_t") {
+    return unique_ptr<ValueCheck>(new TypedCheck<long long>(type, choices, range));
+  }
+  if (type == "unsigned long long" || type == "uint64_t") {
+    return unique_ptr<ValueCheck>(new TypedCheck<unsigned long long>(type, choices, range));
+  }
+  if (type == "double")             return unique_ptr<ValueCheck>(new TypedCheck<double>(type, choices, range));
+  if (type == "float")              return unique_ptr<ValueCheck>(new TypedCheck<float>(type, choices, range));
+  if (type == "bool")               return unique_ptr<ValueCheck>(new TypedCheck<bool>(type, choices, range));
+  return unique_ptr<ValueCheck>(new TypedCheck<string>(type, choices, range.size() == 2 ? range : vector<string>()));
+}
+
+//----------------------------------------------------------------------
+/// an option of the schema
+struct SchemaOption {
+  string option;
+  vector<string> aliases;
+  string kind;
+  bool required = false;
+  /// true for value_bool-style options, whose value is optional and
+  /// which can be negated with -no-opt
+  bool optional_bool_value = false;
+  unsigned min_count = 0, max_count = CmdLine::any_count;
+  unique_ptr<ValueCheck> check;
+
+  bool takes_value() const {return kind != "present";}
+};
+
+/// the options of a program, as written by its --cmdline-schema
+class Schema {
+public:
+  Schema(const string & filename) {
+    ifstream in(filename);
+    if (!in.good()) throw CmdLine::Error("could not open schema " + filename);
+    ostringstream content;
+    content << in.rdbuf();
+    const string text = content.str();
+    Json json = JsonParser(text).parse();
+    if (json["cmdline_schema"].type != Json::number) {
+      throw CmdLine::Error(filename + " is not a CmdLine schema (from --cmdline-schema)");
+    }
+    program = json["program"].string_value;
+    argfile_option = json["argfile_option"].string_value;
+    for (const auto & sub: json["subcommands"].strings()) subcommands.insert(sub);
+    for (const auto & entry: json["options"].array_value) {
+      options.emplace_back();
+      SchemaOption & opt = options.back();
+      opt.option   = entry["option"].string_value;
+      opt.aliases  = entry["aliases"].strings();
+      opt.kind     = entry["kind"].string_value;
+      opt.required = entry["required"].boolean_value;
+      const string & type = entry["type"].string_value;
+      opt.optional_bool_value = entry["optional_value"].boolean_value;
+      if (entry["min_count"].type == Json::number) opt.min_count = unsigned(entry["min_count"].number_value);
+      if (entry["max_count"].type == Json::number) opt.max_count = unsigned(entry["max_count"].number_value);
+      if (opt.takes_value()) opt.check = make_check(type, entry["choices"].strings(), entry["range"].strings());
+    }
+    for (size_t i = 0; i < options.size(); i++) {
+      if (options[i].kind == "positional") {
+        positional = &options[i];
+        continue;
+      }
+      for (const auto & alias: options[i].aliases) alias_index[alias] = i;
+      if (options[i].optional_bool_value) {
+        for (const auto & alias: options[i].aliases) negation_index["-no" + alias] = i;
+      }
+    }
+  }
+
+  /// returns the problems with the argfile (none if it is valid); if
+  /// the argfile describes a sweep, every point of the sweep is checked
+  vector<string> validate(const string & argfile) const;
+
+  /// returns the problems with the (expanded) arguments of a run
+  vector<string> validate_arguments(const vector<string> & args) const;
+
+  string program, argfile_option;
+  set<string> subcommands;
+  vector<SchemaOption> options;
+  const SchemaOption * positional = nullptr;
+  unordered_map<string,size_t> alias_index, negation_index;
+};
+
+vector<string> Schema::validate(const string & argfile) const {
+  // the argfile is read by CmdLine itself, so that comments, nested
+  // argfiles and sweeps are handled as in the program; --sweep-size
+  // gives the number of points (1 without a sweep) and the first one
+  vector<string> args{program, argfile_option, argfile, "--sweep-size"};
+  auto parsed = CmdLine::try_parse(args, false, argfile_option);
+  if (!parsed) return {parsed.error().message()};
+  const uint64_t n_points = parsed.value().sweep_size();
+  if (n_points == 1) return validate_arguments(parsed.value().arguments());
+
+  // each point is then parsed as the program would parse it with
+  // --sweep-index, and each distinct problem is reported once, with
+  // the first point at which it occurs
+  vector<string> problems;
+  set<string> seen;
+  args.back() = "--sweep-index";
+  args.emplace_back();
+  for (uint64_t ipoint = 0; ipoint < n_points; ipoint++) {
+    args.back() = to_string(ipoint);
+    auto point = CmdLine::try_parse(args, false, argfile_option);
+    vector<string> point_problems = point ? validate_arguments(point.value().arguments())
+                                          : vector<string>{point.error().message()};
+    for (const auto & problem: point_problems) {
+      if (seen.insert(problem).second) {
+        problems.push_back(problem + " (sweep point " + to_string(ipoint) + " of " + to_string(n_points) + ")");
+      }
+    }
+  }
+  return problems;
+}
+
+vector<string> Schema::validate_arguments(const vector<string> & args) const {
+  vector<string> problems;
+  // for each option, the alias with which it was first given
+  vector<string> given(options.size());
+  vector<string> positional_args;
+  bool end_of_options = false;
+  for (size_t iarg = 1; iarg < args.size(); iarg++) {
+    const string & arg = args[iarg];
+    if (end_of_options || arg.size() == 0 || arg[0] != '-') {
+      if (!end_of_options && positional_args.size() == 0 && subcommands.count(arg)) break;
+      positional_args.push_back(arg);
+      continue;
+    }
+    if (arg == "--") {end_of_options = true; continue;}
+
+    auto found = alias_index.find(arg);
+    bool negated = false;
+    if (found == alias_index.end()) {
+      found = negation_index.find(arg);
+      negated = true;
+      if (found == negation_index.end()) {
+        problems.push_back("unknown option " + arg);
+        continue;
+      }
+    }
+    const SchemaOption & opt = options[found->second];
+    string & first_given = given[found->second];
+    if (first_given.size() != 0 && opt.kind != "all_values") {
+      if (first_given == arg) problems.push_back("option " + arg + " given more than once");
+      else                    problems.push_back("options " + first_given + " and " + arg + " are mutually exclusive");
+    } else if (first_given.size() == 0) {
+      first_given = arg;
+    }
+    if (!opt.takes_value() || negated) continue;
+
+    // the value, if any (a value_bool option may be given without one)
+    bool has_value = iarg + 1 < args.size() && args[iarg+1] != "--";
+    if (opt.optional_bool_value && has_value && args[iarg+1].compare(0,1,"-") == 0) has_value = false;
+    if (!has_value) {
+      if (!opt.optional_bool_value) problems.push_back("option " + arg + " is missing its value");
+      continue;
+    }
+    const string & value = args[++iarg];
+    string problem = opt.check->check(value);
+    if (problem.size() != 0) problems.push_back("value " + value + " of option " + arg + " " + problem);
+  }
+
+  for (size_t i = 0; i < options.size(); i++) {
+    if (options[i].kind == "required_value" && given[i].size() == 0) {
+      problems.push_back("required option " + options[i].option + " is missing");
+    }
+  }
+  if (positional) {
+    if (positional_args.size() < positional->min_count || positional_args.size() > positional->max_count) {
+      problems.push_back(to_string(positional_args.size()) + " " + positional->option + " arguments given, "
+                         + "but " + to_string(positional->min_count) + " to "
+                         + (positional->max_count == CmdLine::any_count ? string("any number")
+                                                                       : to_string(positional->max_count))
+                         + " are allowed");
+    }
+    for (const auto & arg: positional_args) {
+      string problem = positional->check->check(arg);
+      if (problem.size() != 0) problems.push_back(positional->option + " argument " + arg + " " + problem);
+    }
+  } else if (subcommands.size() != 0 && positional_args.size() != 0) {
+    problems.push_back("unknown subcommand " + positional_args[0]);
+  } else {
+    for (const auto & arg: positional_args) problems.push_back("unexpected argument " + arg);
+  }
+  return problems;
+}
+
+//----------------------------------------------------------------------
+int main(int argc, char ** argv) {
+  CmdLine cmdline(argc, argv);
+  cmdline.help("Checks argfiles against the options of a program, as written by the "
+               "program's --cmdline-schema, without running the program.");
+  string schema_file = cmdline.value<string>("-schema").argname("filename")
+                              .help("the schema, from prog --cmdline-schema > filename");
+  unsigned n_threads = cmdline.value<unsigned>("-j", std::max(1u, thread::hardware_concurrency()))
+                              .help("number of threads for checking the argfiles");
+  bool verbose = cmdline.present("-v").help("also print the argfiles that are valid");
+  auto list = cmdline.optional_value<CmdLine::ListFile>("-list").argname("@filename")
+                     .help("a file with the names of the argfiles, one per line");
+  vector<string> argfiles = cmdline.positional<string>("argfiles").help("the argfiles to check");
+  cmdline.assert_all_options_used();
+  if (list.present()) {
+    for (const auto & file: list.value()) argfiles.emplace_back(file);
+  }
+
+  // problems are reported below, rather than printed as they are found
+  CmdLine::Error::set_print_message(false);
+  int exit_code = 0;
+  try {
+    const Schema schema(schema_file);
+
+    vector<vector<string>> problems(argfiles.size());
+    atomic<size_t> next_file{0};
+    auto validate = [&]() {
+      for (size_t i = next_file++; i < argfiles.size(); i = next_file++) {
+        try {
+          problems[i] = schema.validate(argfiles[i]);
+        } catch (const CmdLine::Error & error) {
+          problems[i] = {error.message()};
+        }
+      }
+    };
+    vector<thread> threads;
+    for (unsigned i = 1; i < n_threads; i++) threads.emplace_back(validate);
+    validate();
+    for (auto & thread: threads) thread.join();
+
+    size_t n_invalid = 0;
+    for (size_t i = 0; i < argfiles.size(); i++) {
+      if (problems[i].size() == 0) {
+        if (verbose) cout << argfiles[i] << ": OK" << endl;
+        continue;
+      }
+      n_invalid++;
+      for (const auto & problem: problems[i]) cout << argfiles[i] << ": " << problem << endl;
+    }
+    cerr << "# checked " << argfiles.size() << " argfiles against the options of " << schema.program
+         << ": " << n_invalid << " invalid" << endl;
+    if (n_invalid != 0) exit_code = 1;
+  } catch (const CmdLine::Error & error) {
+    cerr << "Error: " << error.message() << endl;
+    exit_code = 2;
+  }
+  return exit_code;
+}
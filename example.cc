@@ -81,6 +81,8 @@ int main (int argc, char ** argv) {
 
   // output a header with various info (command-line, path, time, system)
   cout << cmdline.header() ;
+  // and a footer with the resources used (CPU time, memory, I/O) at the end
+  cmdline.footer_at_exit();
   // output the values
   cout << "ival = " << ival << endl;
   cout << "dval = " << dval << " (argument was " << (d_present ? "" : "not " ) << "present)" << endl;
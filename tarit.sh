@@ -3,7 +3,7 @@
 mkdir tmp || exit
 if [[ ! -e releases ]] mkdir releases
 
-tar zcf tmp/tmp.tgz *.cc *.hh *.sh *.pl *.md Makefile [A-Z]*[A-Z]
+tar zcf tmp/tmp.tgz *.cc *.hh *.sh *.md Makefile [A-Z]*[A-Z]
 
 cd tmp
 tar zxf tmp.tgz
@@ -1,14 +1,34 @@
 #include "CmdLine.hh"
+#include "CmdLineEnum.hh"
 #include <cassert>
 #include <iostream>
 #include <list>
+#include <fstream>
+#include <sstream>
 #include <optional>
+#include <random>
+#include <cstring>
+#include <cmath>
+#include <new>
+#include <cstdlib>
 
 using namespace std;
 
 int n_checks = 0;
 bool verbose_successes = false;
 
+/// number of calls to operator new, to check that some operations
+/// do not allocate memory
+long n_allocations = 0;
+void * operator new(size_t size) {
+  n_allocations++;
+  void * ptr = malloc(size == 0 ? 1 : size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+void operator delete(void * ptr) noexcept {free(ptr);}
+void operator delete(void * ptr, size_t) noexcept {free(ptr);}
+
 /// return a vector of strings, split by spaces
 vector<string> split_spaces(const string& s) {
   return CmdLine::split_at_spaces("dummy " + s);
@@ -26,7 +46,7 @@ template<std::size_t I = 0, typename... Tp>
 inline typename std::enable_if<I < sizeof...(Tp), void>::type
   print(const std::tuple<Tp...>& t)
   {
-    std::cerr << std::get<I>(t) << " ";
+    std::cerr << CmdLine_value_to_string(std::get<I>(t)) << " ";
     print<I + 1, Tp...>(t);
   }
 
@@ -87,11 +107,49 @@ void check_fail(const int line_number, const U & fn, const string & options) {
 #define CHECK_FAIL(fn, options)           (check_fail(__LINE__, fn, options))
 #define CHECK_PASS_NOHELP(fn, options, expected) (check_pass(__LINE__, fn, options, expected, false))
 
+/// check that n_doubles random doubles, spread over the full range of
+/// exponents, survive a round trip through value_as_string() and 
+/// CmdLine_string_to_value<double>
+void check_double_roundtrip(long n_doubles) {
+  n_checks++;
+  std::mt19937_64 generator(20260319);
+  for (long i = 0; i < n_doubles; i++) {
+    uint64_t bits = generator();
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    if (!std::isfinite(x)) continue;
+    string str = CmdLine::Result<double>(x).value_as_string();
+    double y = CmdLine_string_to_value<double>(str);
+    if (memcmp(&x, &y, sizeof(x)) != 0) {
+      cerr << "Round-trip failure: " << str << " converted back to " << y << endl;
+      throw runtime_error("CmdLine round-trip failure");
+    }
+  }
+  // and check some values that should have short representations
+  if (CmdLine::Result<double>(0.1).value_as_string() != "0.1"
+      || CmdLine::Result<double>(1e-300).value_as_string() != "1e-300"
+      || CmdLine::Result<float>(0.3f).value_as_string() != "0.3"
+      || CmdLine::Result<int>(-42).value_as_string() != "-42") {
+    throw runtime_error("CmdLine shortest-representation failure");
+  }
+}
+
+/// enums whose values are read and written by name
+#define PROCESSES(X) X(qq) X(qg) X(gg = 5) X(gluon_gluon = 5)
+CMDLINE_ENUM(Process, PROCESSES)
+enum Colour {red, green = 4, blue};
+#define COLOURS(X) X(red) X(green) X(blue)
+CMDLINE_ENUM_IO(Colour, COLOURS)
+
 int main(int argc, char ** argv) {
+  long n_roundtrip;
   {
     CmdLine cmdline(argc, argv);
     verbose_successes = cmdline.value_bool({"-v","-verbose","--verbose"}, false)
                                .help("print out message for each successful check");
+    n_roundtrip = cmdline.value<long>("-n-roundtrip", 100000)
+                               .help("number of random doubles for the round-trip check "
+                                     "(e.g. 10000000 for a more exhaustive check)");
     cmdline.assert_all_options_used();
   }
 
@@ -277,6 +335,803 @@ int main(int argc, char ** argv) {
     CHECK_FAIL(cmd_reuse_wrong_type, "");
   }
 
+  {
+    // large values are shared by copies of the Result, by reuse_value
+    // and by dump(), and accessing them does not copy them
+    n_checks++;
+    CmdLine cmdline(split_spaces("-s " + string(100, 'a') + " -x 1 -x 2"));
+    auto s = cmdline.value<string>("-s");
+    auto x = cmdline.value_all<double>("-x");
+    auto s_copy = s;
+    long allocations_before = n_allocations;
+    double sum = 0;
+    for (int i = 0; i < 10; i++) sum += x.value()[1] + x()[0] + double(s().size());
+    auto s_reused = cmdline.reuse_value<string>("-s");
+    long allocations = n_allocations - allocations_before;
+    if (&s.value() != &s_copy.value() || &s_reused.value() != &s.value() || sum != 1030 || allocations != 0) {
+      throw runtime_error("CmdLine::Result sharing failure (allocations = " + to_string(allocations) + ")");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify queries with option names given as literals, static arrays of
+  // aliases and (in C++17) string views; once the options have been
+  // registered, queries for values stored within the Result (e.g. numbers)
+  // should not allocate memory
+  {
+    static const char * const number_opts[] = {"-n", "--a-rather-long-number-option"};
+    auto cmd_names = [](CmdLine & cmdline){
+      return make_tuple(cmdline.value<int>(number_opts, 1).value(), 
+                        cmdline.value<string>({"-o","--output"}, "none").value(), 
+                        cmdline.value_bool({"-v","--verbose"}, true).value());
+    };
+    CHECK_PASS(cmd_names, "--a-rather-long-number-option 3 -o out.dat -no-v", 
+               make_tuple(3, string("out.dat"), false));
+    CHECK_FAIL(cmd_names, "-n 1 --a-rather-long-number-option 2");
+
+    n_checks++;
+    CmdLine cmdline(split_spaces("--a-rather-long-number-option 3 -x 1.5 -no-verbose --yet-another-long-option"));
+    double x = 0;
+    auto queries = [&](){
+      x += cmdline.value<int>(number_opts, 1);
+      x += cmdline.value_bool({"-v","--verbose"}, true) ? 1 : 0;
+      x += cmdline.value<double>("-x");
+      x += cmdline.present("--yet-another-long-option") ? 1 : 0;
+#if __cplusplus >= 201703L
+      x += cmdline.value<double>(std::string_view("-xyz").substr(0,2));
+#endif
+    };
+    queries();
+    long allocations_before = n_allocations;
+    for (int i = 0; i < 10; i++) queries();
+    long allocations = n_allocations - allocations_before;
+    if (allocations != 0 || x < 55) {
+      throw runtime_error("CmdLine allocation-free query failure (allocations = " + to_string(allocations) + ")");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify value_or_else, with defaults computed only when needed
+  {
+    int n_calls = 0;
+    auto cmd_or_else = [&n_calls](CmdLine & cmdline){
+      n_calls = 0;
+      auto costly = [&n_calls]{n_calls++; return string("table");};
+      auto x  = cmdline.value_or_else<double>("-x", [&n_calls]{n_calls++; return 3;});
+      auto s  = cmdline.value_or_else({"-s","--str"}, [&n_calls]{n_calls++; return string("def");});
+      auto v  = cmdline.value_or_else("-v", costly, "built-in table");
+      return make_tuple(x(), s(), v().size(), v.present(), n_calls);
+    };
+    CHECK_PASS(cmd_or_else, "",                         make_tuple(3.0, string("def"), size_t(5), false, 3));
+    CHECK_PASS(cmd_or_else, "-x 1 --str abc",           make_tuple(1.0, string("abc"), size_t(5), false, 1));
+    CHECK_PASS(cmd_or_else, "-v tab",                   make_tuple(3.0, string("def"), size_t(3), true,  2));
+    CHECK_FAIL(cmd_or_else, "-x");
+
+    // with -h, the placeholder is not checked against choices or a range
+    auto cmd_or_else_valid = [](CmdLine & cmdline){
+      string d = cmdline.value_or_else("-d", []{return string("a");}, "first dataset").choices({"a","b"});
+      int    n = cmdline.value_or_else("-n", []{return 3;}, "three").range(1, 5);
+      return make_tuple(d, n, cmdline.help_requested());
+    };
+    CHECK_PASS(cmd_or_else_valid, "", make_tuple(string("a"), 3, false));
+    CHECK_FAIL(cmd_or_else_valid, "-h -d c");
+    for (const char * help: {"-h", "--cmdline-schema", "--cmdline-completion bash"}) {
+      n_checks++;
+      CmdLine help_cmdline(split_spaces(string(help) + " -n 5"));
+      if (cmd_or_else_valid(help_cmdline) != make_tuple(string(""), 5, true)) {
+        throw runtime_error("CmdLine::value_or_else failure with choices or range and " + string(help));
+      }
+    }
+
+    // with -h, the placeholder avoids the computation
+    n_checks++;
+    CmdLine cmdline(split_spaces("-h -x 2"));
+    cmd_or_else(cmdline);
+    if (n_calls != 2 || cmdline.value_or_else<double>("-x", []{return 3;}).opthelp().default_value != "3" 
+        || cmdline.value_or_else("-v", []{return string();}, "built-in table").opthelp().default_value != "built-in table") {
+      throw runtime_error("CmdLine::value_or_else failure with help, n_calls = " + to_string(n_calls));
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify parameter sweeps
+  {
+    auto cmd_sweep = [](CmdLine & cmdline){
+      return make_tuple(cmdline.value<double>("-x"), cmdline.value<int>("-n", 0), 
+                        cmdline.sweep_index(), cmdline.sweep_size());
+    };
+    CHECK_PASS(cmd_sweep, "-x 0.3",                                        make_tuple(0.3, 0, -1LL, uint64_t(1)));
+    CHECK_PASS(cmd_sweep, "-x {0.1,0.2,0.5} --sweep-index 2",              make_tuple(0.5, 0, 2LL,  uint64_t(3)));
+    CHECK_PASS(cmd_sweep, "-x {0.1,0.2,0.5} -n 1:10:3 --sweep-index 4",    make_tuple(0.2, 1, 4LL,  uint64_t(12)));
+    CHECK_PASS(cmd_sweep, "-x {0.1,0.2,0.5} -n 1:10:3 --sweep-index 11",   make_tuple(0.5, 10, 11LL, uint64_t(12)));
+    CHECK_PASS(cmd_sweep, "-x 0.1:0.3:0.1 -n {1,2,3} --sweep-zip --sweep-index 2", make_tuple(0.3, 3, 2LL, uint64_t(3)));
+    CHECK_PASS(cmd_sweep, "-x -1:1:0.5 --sweep-index 1",                   make_tuple(-0.5, 0, 1LL, uint64_t(5)));
+    CHECK_FAIL(cmd_sweep, "-x {0.1,0.2,0.5} --sweep-index 3");
+    CHECK_FAIL(cmd_sweep, "-x {0.1,0.2,0.5} --sweep-index -1");
+    CHECK_FAIL(cmd_sweep, "-x {0.1,0.2,0.5} -n {1,2} --sweep-zip --sweep-index 0");
+    CHECK_FAIL(cmd_sweep, "-x 1:2:0 --sweep-index 0");
+    CHECK_FAIL(cmd_sweep, "-n 0:99999999999999999999:1 --sweep-index 0");
+    CHECK_FAIL(cmd_sweep, "-n -9223372036854775807:9223372036854775807:1 --sweep-index 0");
+    CHECK_FAIL(cmd_sweep, "-x 0:1e300:1e-300 --sweep-index 0");
+    CHECK_FAIL(cmd_sweep, "-x {0.1,0.2,0.5}");
+
+    n_checks++;
+    CmdLine::Sweep sweep(split_spaces("-n 1:1000:10 -x {0.1,0.2,0.5} -m 0:1:1"));
+    if (sweep.size() != 600 || sweep.n_dimensions() != 3 || sweep.value(1, 2) != "0.2"
+        || sweep.arguments(599)[2] != "991") {
+      throw runtime_error("CmdLine::Sweep failure");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify clones with overrides
+  {
+    auto cmd_clone = [](CmdLine & cmdline){
+      CmdLine clone = cmdline.with_overrides({{"-eps","1e-4"},{"-f",""}})
+                             .with_overrides({{"-n","7"}});
+      cmdline.value<string>("-s","a");
+      auto result = make_tuple(cmdline.value("-eps",0.1).value(), cmdline.value("-n",1).value(),
+                               clone.value("-eps",0.1).value(), clone.value("-n",1).value(),
+                               clone.present("-f").value(),     clone.value<string>("-s","a").value());
+      clone.assert_all_options_used();
+      return result;
+    };
+    CHECK_PASS(cmd_clone, "",                  make_tuple(0.1,  1, 1e-4, 7, true, string("a")));
+    CHECK_PASS(cmd_clone, "-eps 0.2 -n 3",     make_tuple(0.2,  3, 1e-4, 7, true, string("a")));
+    CHECK_PASS(cmd_clone, "-eps 0.2 -s b",     make_tuple(0.2,  1, 1e-4, 7, true, string("b")));
+    CHECK_FAIL(cmd_clone, "-eps 0.2 -s b -u");
+
+    n_checks++;
+    CmdLine cmdline(split_spaces("-eps 0.2"));
+    CmdLine clone = cmdline.with_overrides({{"-eps","1e-4"}});
+    if (clone.command_line() != "dummy -eps 0.2 -eps 1e-4 " || clone.arguments().size() != 5) {
+      throw runtime_error("CmdLine::with_overrides failure for command line");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify value_all for repeated options
+  {
+    auto cmd_all = [](CmdLine & cmdline){
+      return make_tuple(cmdline.value_all<string>({"-f","--file"}).value(), 
+                        cmdline.value_all<int>("-n").value(),
+                        cmdline.value<int>("-i", 0).value());
+    };
+    using vs = vector<string>;
+    using vi = vector<int>;
+    CHECK_PASS(cmd_all, "",                          make_tuple(vs{},         vi{},     0));
+    CHECK_PASS(cmd_all, "-f a",                      make_tuple(vs{"a"},      vi{},     0));
+    CHECK_PASS(cmd_all, "-f a -i 3 --file b -f c",   make_tuple(vs{"a","b","c"}, vi{},  3));
+    CHECK_PASS(cmd_all, "-n 1 -f a -n -2 -n 3",      make_tuple(vs{"a"},      vi{1,-2,3}, 0));
+    CHECK_FAIL(cmd_all, "-n 1 -n x");
+    CHECK_FAIL(cmd_all, "-f a -f");
+
+    n_checks++;
+    CmdLine cmdline(split_spaces("-n 1 -n 2"));
+    cmdline.value_all<int>("-n");
+    if (cmdline.dump("# ","// ","",true).find("-n 1\n-n 2\n") == string::npos) {
+      throw runtime_error("CmdLine::value_all failure in dump");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify positional arguments
+  {
+    auto cmd_pos = [](CmdLine & cmdline){
+      int n = cmdline.value<int>("-n", 0);
+      bool v = cmdline.present("-v");
+      auto view = cmdline.positional_view("inputs", 1).value();
+      return make_tuple(n, v, vector<string>(view.begin(), view.end()));
+    };
+    using vs = vector<string>;
+    CHECK_PASS(cmd_pos, "a",                    make_tuple(0, false, vs{"a"}));
+    CHECK_PASS(cmd_pos, "a b -n 3 c",           make_tuple(3, false, vs{"a","b","c"}));
+    CHECK_PASS(cmd_pos, "-v a -n -3 b",         make_tuple(-3, true, vs{"a","b"}));
+    CHECK_PASS(cmd_pos, "-n 2 -- -v c",         make_tuple(2, false, vs{"-v","c"}));
+    CHECK_FAIL(cmd_pos, "-n 2");
+    CHECK_FAIL(cmd_pos, "-u a");
+
+    auto cmd_pos_int = [](CmdLine & cmdline){
+      return make_tuple(cmdline.positional<int>("n", 2, 3).value());
+    };
+    CHECK_PASS(cmd_pos_int, "1 2",    make_tuple(vector<int>{1,2}));
+    CHECK_PASS(cmd_pos_int, "1 2 3",  make_tuple(vector<int>{1,2,3}));
+    CHECK_FAIL(cmd_pos_int, "1");
+    CHECK_FAIL(cmd_pos_int, "1 2 3 4");
+    CHECK_FAIL(cmd_pos_int, "1 x");
+
+    // positional arguments that look like options are dumped after "--",
+    // so that the dump can be read back as an argfile
+    n_checks++;
+    const string dump_name = "unit-tests-positional.tmp";
+    {
+      CmdLine cmdline(split_spaces("-n 2 -- -5 x"));
+      cmd_pos(cmdline);
+      ofstream dump_out(dump_name);
+      dump_out << cmdline.dump();
+    }
+    CmdLine reread(split_spaces("-argfile " + dump_name));
+    auto reread_result = cmd_pos(reread);
+    remove(dump_name.c_str());
+    if (reread_result != make_tuple(2, false, vs{"-5","x"})) {
+      throw runtime_error("CmdLine::dump failure for positional arguments starting with '-'");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify subcommands
+  {
+    auto cmd_sub = [](CmdLine & cmdline){
+      bool v = cmdline.present("-v");
+      double x = 0; int n = 0, n_registered = 0;
+      cmdline.subcommand("fit", "fit a model", [&](CmdLine & sub){
+        n_registered++;
+        x = sub.value<double>("-x", 1.0);
+      });
+      cmdline.subcommand("plot", "plot the result", [&](CmdLine & sub){
+        n_registered++;
+        n = sub.value<int>("-n");
+      });
+      return make_tuple(cmdline.subcommand_name(), v, x, n, n_registered);
+    };
+    CHECK_PASS(cmd_sub, "",                   make_tuple(string(""),     false, 0.0, 0, 0));
+    CHECK_PASS(cmd_sub, "-v fit",             make_tuple(string("fit"),  true,  1.0, 0, 1));
+    CHECK_PASS(cmd_sub, "fit -x 3",           make_tuple(string("fit"),  false, 3.0, 0, 1));
+    CHECK_PASS(cmd_sub, "-v plot -n 2",       make_tuple(string("plot"), true,  0.0, 2, 1));
+    CHECK_FAIL(cmd_sub, "plot -n 2 -v");
+    CHECK_FAIL(cmd_sub, "fit -n 2");
+    CHECK_FAIL(cmd_sub, "plot");
+    CHECK_FAIL(cmd_sub, "walk");
+
+    n_checks++;
+    CmdLine cmdline(split_spaces("-v fit -x 3"));
+    cmd_sub(cmdline);
+    if (cmdline.dump("# ","// ","",true).find("-v\n# Options for getting help\n# subcommand\nfit\n") == string::npos
+        || cmdline.subcommand_cmdline().command_name() != "dummy fit") {
+      throw runtime_error("CmdLine::subcommand failure in dump or command_name");
+    }
+
+    // a clone made before the subcommand still sees the subcommand's
+    // options, and help after the subcommand is for the subcommand
+    n_checks++;
+    CmdLine parent(split_spaces("-n 3 fit -x 2 -h"));
+    CmdLine clone = parent.with_overrides({});
+    bool parent_help = parent.help_requested();
+    parent.value<int>("-n");
+    parent.subcommand("fit", "", [](CmdLine & sub){sub.value<double>("-x", 1.0);});
+    if (!parent_help || parent.help_requested() || !parent.subcommand_cmdline().help_requested()
+        || !clone.present("-x") || clone.value<int>("-n") != 3) {
+      throw runtime_error("CmdLine::subcommand failure with clone or help");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify shell completion scripts
+  {
+    n_checks++;
+    CmdLine completion_cmdline(split_spaces("-n 2"));
+    completion_cmdline.value<int>("-n").choices({1,2,3}).help("number");
+    completion_cmdline.optional_value<string>({"-o","--out"}).help("output file");
+    completion_cmdline.present("-v").help("verbose");
+    string bash = completion_cmdline.completion_script("bash");
+    string zsh  = completion_cmdline.completion_script("zsh");
+    string fish = completion_cmdline.completion_script("fish");
+    if (bash.find("    -n)\n      COMPREPLY=( $(compgen -W \"1 2 3\" -- \"$cur\") )") == string::npos
+        || bash.find("    -o|--out)\n") == string::npos
+        || bash.find("complete -o default -F _dummy_completion dummy") == string::npos
+        || zsh.find("'(-o --out)'{-o,--out}'[output file]:val:_files' \\") == string::npos
+        || fish.find("complete -c dummy -s v -d 'verbose'") == string::npos) {
+      throw runtime_error("CmdLine::completion_script failure");
+    }
+    auto cmd_completion = [](CmdLine & cmdline){return make_tuple(cmdline.completion_script("tcsh"));};
+    CHECK_FAIL(cmd_completion, "");
+    // the completion is for the whole program, not for a subcommand
+    auto cmd_sub_completion = [](CmdLine & cmdline){
+      cmdline.subcommand("fit", "fit a model", [](CmdLine & sub){sub.value<double>("-x", 1.0);});
+      return make_tuple(cmdline.subcommand_name());
+    };
+    CHECK_FAIL(cmd_sub_completion, "fit --cmdline-completion bash");
+  }
+
+  //---------------------------------------------------------------------------
+  // verify the JSON schema, and that --cmdline-schema behaves as help
+  {
+    n_checks++;
+    CmdLine schema_cmdline(split_spaces("--cmdline-schema"));
+    schema_cmdline.value<int>({"-n","--number"}).range(1, 5).help("number");
+    schema_cmdline.value<string>("-s", "a\"b").choices({"a\"b", "c"});
+    schema_cmdline.positional<double>("x", 1, 2);
+    schema_cmdline.value_bool("-f", true);
+    schema_cmdline.value<bool>("-g", true);
+    string schema = schema_cmdline.schema();
+    if (!schema_cmdline.help_requested()
+        || schema.find("{\"option\": \"-n\", \"aliases\": [\"-n\", \"--number\"], \"kind\": \"required_value\", "
+                       "\"type\": \"int\", \"required\": true, \"range\": [\"1\", \"5\"]}") == string::npos
+        || schema.find("\"default\": \"a\\\"b\", \"choices\": [\"a\\\"b\", \"c\"]}") == string::npos
+        || schema.find("\"kind\": \"positional\", \"type\": \"double\", \"required\": true, "
+                       "\"min_count\": 1, \"max_count\": 2}") == string::npos
+        // only value_bool options can be given without their value
+        || schema.find("\"option\": \"-f\", \"aliases\": [\"-f\"], \"kind\": \"value_with_default\", "
+                       "\"type\": \"bool\", \"required\": false, \"optional_value\": true") == string::npos
+        || schema.find("\"optional_value\": ") != schema.rfind("\"optional_value\": ")) {
+      throw runtime_error("CmdLine::schema failure, with schema\n" + schema);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify list files given as @filename
+  {
+    const string list_name = "unit-tests-list.tmp";
+    {
+      ofstream list_out(list_name);
+      list_out << "a.dat\n\n# comment\nb c.dat\r\nd.dat";
+    }
+    auto cmd_list = [](CmdLine & cmdline){
+      auto list = cmdline.value<CmdLine::ListFile>("-input").value();
+      vector<string> entries;
+      for (const auto & entry: list) entries.push_back(string(entry));
+      return make_tuple(entries, list.size(), list.from_file());
+    };
+    using vs = vector<string>;
+    CHECK_PASS(cmd_list, "-input @" + list_name,  make_tuple(vs{"a.dat","b c.dat","d.dat"}, size_t(3), true));
+    CHECK_PASS(cmd_list, "-input x.dat",          make_tuple(vs{"x.dat"}, size_t(1), false));
+    CHECK_FAIL(cmd_list, "-input @nonexistent-list.tmp");
+
+    n_checks++;
+    CmdLine cmdline(split_spaces("-input @" + list_name));
+    cmdline.value<CmdLine::ListFile>("-input");
+    string dump = cmdline.dump("# ","// ","",true);
+    if (dump.find("-input @" + list_name + "  # 3 entries, fnv1a64 ") == string::npos
+        || cmdline.command_line().find("a.dat") != string::npos) {
+      throw runtime_error("CmdLine::ListFile failure in dump or command_line");
+    }
+    remove(list_name.c_str());
+  }
+
+  //---------------------------------------------------------------------------
+  // verify arrays mapped or read from files given as @filename
+  {
+    const string text_name = "unit-tests-array.tmp", bin_name = "unit-tests-array.bin";
+    const string bad_name = "unit-tests-array-bad.tmp";
+    const vector<double> values{1.5, -2, 1e-300};
+    {
+      ofstream text_out(text_name);
+      text_out << "# weights\n1.5 -2\n  1e-300\n";
+      ofstream bin_out(bin_name, ios::binary);
+      bin_out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(double));
+      ofstream bad_out(bad_name);
+      bad_out << "1.0 x\n";
+    }
+    auto cmd_array = [](CmdLine & cmdline){
+      auto array = cmdline.value<CmdLine::MappedArray<double>>("-weights").value();
+      return make_tuple(vector<double>(array.begin(), array.end()), array.binary());
+    };
+    CHECK_PASS(cmd_array, "-weights @" + text_name,  make_tuple(values, false));
+    CHECK_PASS(cmd_array, "-weights @" + bin_name,   make_tuple(values, true));
+    CHECK_PASS(cmd_array, "-weights 3",              make_tuple(vector<double>{3.0}, false));
+    CHECK_FAIL(cmd_array, "-weights @nonexistent-array.tmp");
+    CHECK_FAIL(cmd_array, "-weights @" + bad_name);
+
+    // arrays referring to the same file share their content
+    n_checks++;
+    CmdLine cmdline(split_spaces("-w1 @" + bin_name + " -w2 @" + bin_name));
+    auto w1 = cmdline.value<CmdLine::MappedArray<double>>("-w1").value();
+    auto w2 = cmdline.value<CmdLine::MappedArray<double>>("-w2").value();
+    string dump = cmdline.dump("# ","// ","",true);
+    if (w1.data() != w2.data() || w1.hash() != w2.hash()
+        || dump.find("-w1 @" + bin_name + "  # 3 elements (24 bytes), fnv1a64 ") == string::npos) {
+      throw runtime_error("CmdLine::MappedArray failure in sharing or dump");
+    }
+    remove(text_name.c_str());
+    remove(bin_name.c_str());
+    remove(bad_name.c_str());
+  }
+
+  //---------------------------------------------------------------------------
+  // verify shell-like tokenization of command-line strings
+  {
+    n_checks++;
+    using vs = vector<string>;
+    auto tokens = [](const string & str) {return CmdLine::tokenize(str).strings();};
+    if (tokens("prog  -o \"my file.dat\"\t-t 'a b'\nx\\ y") != vs{"prog","-o","my file.dat","-t","a b","x y"}
+        || tokens(" a\"b c\"d '' \"\" \"q\\\"x\\n\" 'it\\s' ") != vs{"ab cd","","","q\"x\\n","it\\s"}
+        || tokens("") != vs{} || tokens(" \t ") != vs{}
+        || CmdLine::split_at_spaces(" a  b\tc ") != vs{"a","b\tc"}) {
+      throw runtime_error("CmdLine::tokenize failure");
+    }
+
+    auto unterminated = CmdLine::try_parse("prog -o 'my file");
+    if (unterminated || unterminated.error().code() != CmdLine::ParseError::bad_quoting
+        || unterminated.error().position() != 8) {
+      throw runtime_error("CmdLine::try_parse failure for unterminated quote");
+    }
+    auto cmd_unterminated = [](CmdLine &){return make_tuple(CmdLine::tokenize("a \"b").size());};
+    CHECK_FAIL(cmd_unterminated, "");
+
+    // the command line, with its quoting, can be parsed back
+    n_checks++;
+    CmdLine cmdline("prog -o \"my file.dat\" -q \"it's\" -n 3");
+    CmdLine reparsed(cmdline.command_line());
+    if (cmdline.value<string>("-o").value() != "my file.dat" || reparsed.value<string>("-o").value() != "my file.dat"
+        || reparsed.value<string>("-q").value() != "it's" || reparsed.arguments() != cmdline.arguments()) {
+      throw runtime_error("CmdLine(string) failure with quoted arguments");
+    }
+    // including arguments with backslashes, tabs, quotes of both kinds,
+    // characters special to the shell, and empty arguments
+    n_checks++;
+    CmdLine awkward(vs{"prog", "a\\b", "x\ty", "", "it's \"x\"", "$HOME", "`ls`", "{0,1}", "-n", "3"});
+    CmdLine awkward_reparsed(awkward.command_line());
+    if (awkward_reparsed.arguments() != awkward.arguments()) {
+      throw runtime_error("CmdLine(string) failure with the quoting of command_line(): " + awkward.command_line());
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify reset() and pooled CmdLine objects
+  {
+    auto cmd_reset = [](CmdLine & cmdline){
+      int n = cmdline.value<int>("-n");
+      string out = cmdline.value<string>("-out-filename", "none");
+      cmdline.reset(split_spaces("-n 7 -v"));
+      return make_tuple(n, out, cmdline.value<int>("-n").value(), cmdline.present("-v").value(),
+                        cmdline.value<string>("-out-filename", "none").value());
+    };
+    CHECK_PASS(cmd_reset, "-n 3 -out-filename a-long-output-filename.dat", 
+               make_tuple(3, string("a-long-output-filename.dat"), 7, true, string("none")));
+
+    // reparsing arguments of the same shape should not allocate memory
+    n_checks++;
+    CmdLine cmdline(split_spaces("-n 3 -out-filename a-long-output-filename.dat -v pos"));
+    cmdline.value<int>("-n");
+    vector<vector<string>> args;
+    for (int i = 0; i < 10; i++) {
+      args.push_back(split_spaces("-n " + to_string(i) + " -out-filename another-output-file-" 
+                                  + to_string(i) + ".dat -v pos"));
+    }
+    cmdline.reset(args[0]);
+    long allocations_before = n_allocations;
+    for (const auto & arg: args) cmdline.reset(arg);
+    long allocations = n_allocations - allocations_before;
+    string dump = cmdline.dump("# ","// ","",true);
+    if (cmdline.value<int>("-n") != 9 || dump.find("-n 9") == string::npos
+#if __cplusplus >= 201703L
+        || allocations != 0
+#endif
+        ) {
+      throw runtime_error("CmdLine::reset failure (allocations = " + to_string(allocations) + ")");
+    }
+
+    n_checks++;
+    const CmdLine * first;
+    {
+      auto pooled = CmdLine::pooled(split_spaces("-n 1"));
+      first = &*pooled;
+      if (pooled->value<int>("-n") != 1) throw runtime_error("CmdLine::pooled failure");
+    }
+    auto pooled = CmdLine::pooled(split_spaces("-n 2"));
+    if (&*pooled != first || pooled->value<int>("-n") != 2 || !pooled->all_options_used()) {
+      throw runtime_error("CmdLine::pooled failure in reuse");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify the phase timers and their summary and Chrome trace
+  {
+    // timers are stopped by their destructor, which must not throw
+    static_assert(std::is_nothrow_destructible<CmdLine::PhaseTimer>::value, 
+                  "CmdLine::PhaseTimer destructor should be noexcept");
+    n_checks++;
+    CmdLine cmdline(split_spaces("-n 3"));
+    {
+      auto setup = cmdline.phase("setup");
+      auto compute = cmdline.with_overrides({{"-n","4"}}).phase("compute \"inner\"");
+    }
+    auto io = cmdline.phase("setup");
+    io.stop();
+    double elapsed = io.elapsed();
+    string summary = cmdline.phase_summary();
+    string trace = cmdline.chrome_trace();
+    if (elapsed < 0 || elapsed != io.elapsed() || cmdline.time_elapsed_since_start() > 60
+        || summary.find("# phase setup:") == string::npos || summary.find("(2 calls)") == string::npos
+        || summary.find("# phase compute \"inner\":") == string::npos
+        || trace.find("\"name\": \"compute \\\"inner\\\"\", \"cat\": \"phase\", \"ph\": \"X\"") == string::npos
+        || trace.find("\"args\": {\"name\": \"dummy\"}") == string::npos) {
+      throw runtime_error("CmdLine::phase failure, with summary\n" + summary + "and trace\n" + trace);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify the resource-usage footer
+  {
+    n_checks++;
+    CmdLine cmdline(split_spaces("-n 3"));
+    auto usage = CmdLine::resource_usage();
+    string footer = cmdline.footer("#-- ");
+    if (usage.user_cpu_s < 0 || usage.peak_rss_bytes <= 0 
+        || footer.find("#-- elapsed time: ") == string::npos
+        || footer.find("#-- CPU time: ") == string::npos
+        || footer.find("#-- peak memory (RSS): ") == string::npos
+        || footer.find("#-- context switches: ") == string::npos) {
+      throw runtime_error("CmdLine::footer failure, with footer\n" + footer);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify the configuration fingerprint
+  {
+    auto fingerprint = [](const string & options) {
+      CmdLine cmdline(split_spaces(options));
+      cmdline.value<double>({"-x","--xval"}, 2.0);
+      cmdline.value<int>("-n", 3);
+      cmdline.present("-q").no_dump();
+      cmdline.optional_value<string>("-o");
+      return cmdline.fingerprint();
+    };
+    n_checks++;
+    string reference = fingerprint("-n 3 -x 1");
+    if (reference.size() != 32 
+        || fingerprint("--xval 1.0 -q -n 3") != reference || fingerprint("-x 1e0 -n 003") != reference
+        || fingerprint("-x 1.5 -n 3") == reference || fingerprint("-x 1 -n 4") == reference
+        || fingerprint("-x 1") == reference || fingerprint("-x 1 -n 3 -o out") == reference
+        || fingerprint("-x 2") == fingerprint("")) {
+      throw runtime_error("CmdLine::fingerprint failure");
+    }
+    // the fingerprint ignores the order of the queries, but not the types
+    n_checks++;
+    CmdLine cmdline(split_spaces("-n 3 -x 1"));
+    cmdline.optional_value<string>("-o");
+    cmdline.value<int>("-n", 3);
+    cmdline.value<double>("-x", 2.0);
+    CmdLine cmdline_float(split_spaces("-n 3 -x 1"));
+    cmdline_float.value<float>("-x", 2.0);
+    cmdline_float.value<int>("-n", 3);
+    cmdline_float.optional_value<string>("-o");
+    if (cmdline.fingerprint() != reference || cmdline_float.fingerprint() == reference) {
+      throw runtime_error("CmdLine::fingerprint failure with reordered queries or types");
+    }
+
+    n_checks++;
+    const string output_name = "unit-tests-fingerprint.tmp";
+    {
+      ofstream output(output_name);
+      output << cmdline.header() << "result = 42" << endl;
+    }
+    bool exists = cmdline.fingerprint_exists(output_name) && !cmdline_float.fingerprint_exists(output_name)
+                  && !cmdline.fingerprint_exists("nonexistent-output.tmp")
+                  && cmdline.dump().find("# configuration fingerprint: " + reference) != string::npos;
+    remove(output_name.c_str());
+    if (!exists) throw runtime_error("CmdLine::fingerprint_exists failure");
+  }
+
+  //---------------------------------------------------------------------------
+  // verify scoped options and the enumeration of options matching a pattern
+  {
+    auto cmd_scope = [](CmdLine & cmdline){
+      vector<double> thr;
+      vector<bool> on;
+      for (int i = 1; i <= 3; i++) thr.push_back(cmdline.scope("-det" + to_string(i)).value<double>("-thr", 0.5));
+      for (int i = 1; i <= 3; i++) on.push_back(cmdline.scope("-det" + to_string(i)).present("-on"));
+      auto trigger = cmdline.scope("-trig").scope("-l1");
+      return make_tuple(thr, on, trigger.value<int>("-n", 1).value(), 
+                        cmdline.options_matching("-det*-thr"), cmdline.scope("-det2").options());
+    };
+    using vs = vector<string>;
+    CHECK_PASS(cmd_scope, "-det2-thr 0.7 -det1-on -det3-on -det3-thr 0.1 -trig-l1-n 4", 
+               make_tuple(vector<double>{0.5,0.7,0.1}, vector<bool>{true,false,true}, 4,
+                          vs{"-det2-thr","-det3-thr"}, vs{"-thr"}));
+    CHECK_FAIL(cmd_scope, "-det4-thr 0.7");
+
+    // the options of a scope are grouped together in the dump
+    n_checks++;
+    CmdLine cmdline(split_spaces("-det1-on"));
+    cmd_scope(cmdline);
+    if (cmdline.dump("# ","// ","",true).find("-det1-thr 0.5\n-det1-on\n-det2-thr 0.5\n// -det2-on\n") == string::npos
+        || cmdline.options_matching("-det*") != vs{"-det1-on"} || cmdline.options_matching("*on") != vs{"-det1-on"}
+        || cmdline.options_matching("-det*-thr").size() != 0) {
+      throw runtime_error("CmdLine::scope failure in dump or options_matching, with dump\n" 
+                          + cmdline.dump("# ","// ","",true));
+    }
+
+    // the scope's index follows overrides, reset() and nested scopes, and
+    // a prefix also covers the options of longer prefixes (-det1, -det10)
+    n_checks++;
+    CmdLine family(split_spaces("-det1-thr 0.2 -det10-thr 0.3 -det1-a-n 2"));
+    auto det1 = family.scope("-det1");
+    CmdLine clone = family.with_overrides({{"-det1-thr", "0.4"}, {"-det1-on", ""}});
+    auto clone_det1 = clone.scope("-det1");
+    bool scope_ok = det1.value<double>("-thr", 0.5) == 0.2 && family.scope("-det10").value<double>("-thr", 0.5) == 0.3
+                    && det1.options() == vs{"-a-n", "-thr", "0-thr"} && det1.scope("-a").options() == vs{"-n"}
+                    && det1.scope("-a").value<int>("-n", 1) == 2 && !det1.present("-on")
+                    && clone_det1.value<double>("-thr", 0.5) == 0.4 && clone_det1.present("-on")
+                    && clone_det1.options() == vs{"-a-n", "-on", "-thr", "0-thr"};
+    family.reset(split_spaces("-det1-on"));
+    scope_ok = scope_ok && det1.present("-on") && det1.value<double>("-thr", 0.5) == 0.5 && det1.options() == vs{"-on"}
+               && family.value<double>("-det1-thr", 0.5).opthelp().scope == "-det1";
+    if (!scope_ok) throw runtime_error("CmdLine::scope failure with overrides, reset or nested scopes");
+  }
+
+  //---------------------------------------------------------------------------
+  // verify that dumps can be read back from an output
+  {
+    n_checks++;
+    CmdLine cmdline(split_spaces("-v fit -x 3"));
+    cmdline.present("-v");
+    cmdline.value<int>("-n", 2);
+    cmdline.optional_value<string>("-o");
+    cmdline.subcommand("fit", "fit a model", [&](CmdLine & sub){
+      sub.value<double>("-x", 1.0);
+      sub.optional_value<string>("-o");
+    });
+    using entries = vector<pair<string,string>>;
+    const entries expected{{"-v",""}, {"-n","2"}, {"fit -x","3"}};
+    for (bool compact: {false, true}) {
+      istringstream output("some output\n" + cmdline.dump("#-- ", "// ", "", compact) + "\n-n 4\n");
+      if (CmdLine::read_dump(output, "#-- ") != expected) {
+        throw runtime_error("CmdLine::read_dump failure with dump\n" + cmdline.dump("#-- ", "// ", "", compact));
+      }
+    }
+    istringstream no_dump("-n 4\n");
+    if (CmdLine::read_dump(no_dump).size() != 0) throw runtime_error("CmdLine::read_dump failure without dump");
+  }
+
+  //---------------------------------------------------------------------------
+  // verify enums declared with CMDLINE_ENUM and CMDLINE_ENUM_IO
+  {
+    auto cmd_enum = [](CmdLine & cmdline){
+      auto proc = cmdline.value("-proc", Process::qq);
+      return make_tuple(int(proc()), proc.value_as_string(), int(cmdline.value("-c", red)));
+    };
+    CHECK_PASS(cmd_enum, "",                        make_tuple(0, string("qq"), 0));
+    CHECK_PASS(cmd_enum, "-proc qg -c blue",        make_tuple(1, string("qg"), 5));
+    CHECK_PASS(cmd_enum, "-proc gg -c green",       make_tuple(5, string("gg"), 4));
+    CHECK_PASS(cmd_enum, "-proc gluon_gluon",       make_tuple(5, string("gg"), 0));
+    CHECK_FAIL(cmd_enum, "-proc gq");
+    CHECK_FAIL(cmd_enum, "-proc 1");
+    CHECK_FAIL(cmd_enum, "-c Red");
+
+    using vs = vector<string>;
+    // the names are the choices in the help, unless replaced explicitly
+    auto cmd_choices = [](CmdLine & cmdline){
+      return make_tuple(int(cmdline.value("-proc", Process::qq).choices({Process::qq, Process::gg})()));
+    };
+    CHECK_PASS(cmd_choices, "-proc gg", make_tuple(5));
+    CHECK_FAIL(cmd_choices, "-proc qg");
+    n_checks++;
+    CmdLine cmdline(split_spaces(""));
+    if (cmdline.value<Process>("-proc", Process::qq).opthelp().choices != vs{"qq", "qg", "gg", "gluon_gluon"}
+        || cmdline.value<Colour>("-c", red).opthelp().choices != vs{"red", "green", "blue"}) {
+      throw runtime_error("CMDLINE_ENUM failure for the choices");
+    }
+
+    // and operator<< and operator>>
+    n_checks++;
+    ostringstream ostr;
+    ostr << Process::gg << " " << Process(3) << " " << blue;
+    Process proc = Process::qq;
+    istringstream good("qg"), bad("gq");
+    good >> proc;
+    bad  >> proc;
+    if (ostr.str() != "gg 3 blue" || proc != Process::qg || !good || bad) {
+      throw runtime_error("CMDLINE_ENUM failure in I/O");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify choices(...) and range(...), including repeated queries
+  {
+    auto cmd_valid = [](CmdLine & cmdline){
+      int n = 0;
+      for (int i = 0; i < 3; i++) n = cmdline.value("-n", 2).range(1, 10);
+      string s = cmdline.value<string>("-s", "b").choices({"a", "b", "c"}).choices({"a", "b", "c"});
+      return make_tuple(n, s, int(cmdline.value("-p", Process::qq).choices({Process::qq, Process::gg})()));
+    };
+    CHECK_PASS(cmd_valid,        "-n 10 -s c -p gg", make_tuple(10, string("c"), 5));
+    CHECK_PASS_NOHELP(cmd_valid, "-n 10 -s c -p gg", make_tuple(10, string("c"), 5));
+    CHECK_FAIL(cmd_valid, "-n 11");
+    CHECK_FAIL(cmd_valid, "-n 0");
+    CHECK_FAIL(cmd_valid, "-s d");
+    CHECK_FAIL(cmd_valid, "-p qg");
+    // an absent optional value is not checked, with or without help
+    auto cmd_optional = [](CmdLine & cmdline){
+      auto n = cmdline.optional_value<int>("-n").choices({1, 2});
+      return make_tuple(n.has_value(), n.value_or(0));
+    };
+    CHECK_PASS(cmd_optional,        "", make_tuple(false, 0));
+    CHECK_PASS_NOHELP(cmd_optional, "", make_tuple(false, 0));
+    CHECK_PASS_NOHELP(cmd_optional, "-n 2", make_tuple(true, 2));
+    // a different range or set of choices for the same option is an error
+    CHECK_FAIL([](CmdLine & cmdline){cmdline.value("-n", 2).range(1, 10); 
+                                     return make_tuple(int(cmdline.value("-n", 2).range(1, 9)));}, "");
+    CHECK_FAIL([](CmdLine & cmdline){cmdline.value("-n", 2).choices({1, 2}); 
+                                     return make_tuple(int(cmdline.value("-n", 2).choices({2, 1})));}, "");
+
+    // the help records the range and choices once, and large sets of
+    // choices are validated quickly
+    n_checks++;
+    vector<string> datasets;
+    for (int i = 0; i < 20000; i++) datasets.push_back("dataset" + to_string(i));
+    CmdLine cmdline(split_spaces("-n 3 -d dataset19999"));
+    for (int i = 0; i < 1000; i++) {
+      cmdline.value("-n", 2).range(1, 10);
+      cmdline.value<string>("-d").choices(datasets);
+    }
+    const auto & opthelp = cmdline.value("-n", 2).opthelp();
+    if (opthelp.range_strings != vector<string>{"1", "10"} || opthelp.range_string() != "1 <= val <= 10"
+        || cmdline.value<string>("-d").opthelp().choices.size() != datasets.size()) {
+      throw runtime_error("CmdLine range/choices failure in the help");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify the non-throwing try_parse / try_value
+  {
+    using PE = CmdLine::ParseError;
+    auto cmd_try = [](CmdLine & cmdline){
+      auto n = cmdline.try_value<int>("-n");
+      auto x = cmdline.try_value<double>("-x", 0.5);
+      return make_tuple(n ? n.value() : -1, x ? x.value() : -1.0,
+                        int(n.error().code()), n.error().position(), int(x.error().code()));
+    };
+    CHECK_PASS(cmd_try, "-n 3 -x 2",  make_tuple( 3,  2.0, int(PE::none),               -1, int(PE::none)));
+    CHECK_PASS(cmd_try, "-n 3",       make_tuple( 3,  0.5, int(PE::none),               -1, int(PE::none)));
+    CHECK_PASS(cmd_try, "-x 2",       make_tuple(-1,  2.0, int(PE::option_absent),      -1, int(PE::none)));
+    CHECK_PASS(cmd_try, "-n a -x",    make_tuple(-1, -1.0, int(PE::conversion_failure),  2, int(PE::value_absent)));
+    CHECK_PASS(cmd_try, "-n 99999999999", make_tuple(-1, 0.5, int(PE::conversion_failure), 2, int(PE::none)));
+
+    // the non-throwing conversions agree with the throwing ones
+    n_checks++;
+    for (const string str: {"12", " -7x", "-1", "99999999999", "1e400", "1e-310", ".5", "0x10", "inf", "-", "+3"}) {
+      int i1 = 0, i2 = 0; unsigned u1 = 0, u2 = 0; double d1 = 0, d2 = 0;
+      bool iok = true, uok = true, dok = true;
+      try {i1 = CmdLine_string_to_value<int>(str);}      catch (const CmdLine::ConversionFailure &) {iok = false;}
+      try {u1 = CmdLine_string_to_value<unsigned>(str);} catch (const CmdLine::ConversionFailure &) {uok = false;}
+      try {d1 = CmdLine_string_to_value<double>(str);}   catch (const CmdLine::ConversionFailure &) {dok = false;}
+      if (CmdLine_try_string_to_value(str, i2) != iok || (iok && i1 != i2)
+          || CmdLine_try_string_to_value(str, u2) != uok || (uok && u1 != u2)
+          || CmdLine_try_string_to_value(str, d2) != dok || (dok && d1 != d2)) {
+        throw runtime_error("CmdLine_try_string_to_value disagrees with CmdLine_string_to_value for \"" + str + "\"");
+      }
+    }
+
+    n_checks++;
+    auto bad_argfile = CmdLine::try_parse("dummy -argfile nonexistent-argfile.tmp");
+    auto bad_sweep   = CmdLine::try_parse("dummy -x 1:2:0 --sweep-index 0");
+    auto big_sweep   = CmdLine::try_parse("dummy -s 0:99999999999999999999:1 --sweep-size");
+    auto bad_name    = CmdLine::try_parse(vector<string>{"-n"});
+    auto good        = CmdLine::try_parse("dummy -n 4");
+    if (bad_argfile || bad_argfile.error().code() != PE::argfile_not_found
+        || bad_sweep || bad_sweep.error().message() != "sweep range 1:2:0 has a zero step"
+        || big_sweep || big_sweep.error().message().find("too large for an integer") == string::npos
+        || bad_name  || bad_name.error().code() != PE::bad_command_name
+        || !good || good.value().value<int>("-n") != 4) {
+      throw runtime_error("CmdLine::try_parse failure");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify terminal colour codes, which by default are not written to
+  // streams other than cout/cerr
+  {
+    n_checks++;
+    static_assert(CmdLine::tc::red.sequence()[2] == '3', "tc codes should be constexpr");
+    ostringstream automatic, always, never;
+    automatic << CmdLine::tc::red << "x" << CmdLine::tc::reset;
+    CmdLine::tc::set_mode(CmdLine::tc::always);
+    always << CmdLine::tc::red << "x" << CmdLine::tc::reset;
+    string concatenated = CmdLine::tc::bold + "y" + CmdLine::tc::nobold;
+    CmdLine::tc::set_mode(CmdLine::tc::never);
+    never << CmdLine::tc::red << "x" << CmdLine::tc::reset;
+    string never_string = CmdLine::tc::red;
+    CmdLine::tc::set_mode(CmdLine::tc::automatic);
+    if (automatic.str() != "x" || always.str() != "\033[31mx\033[0m" || never.str() != "x"
+        || concatenated != "\033[1my\033[22m" || never_string != "") {
+      throw runtime_error("CmdLine::tc failure");
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // verify that doubles make exact round trips through strings
+  check_double_roundtrip(n_roundtrip);
 
   cout << "All " << n_checks << " checks passed" << endl;
   return 0;